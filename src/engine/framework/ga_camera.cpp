@@ -69,6 +69,10 @@ void ga_camera::update(ga_frame_params* params)
 	view.make_lookat_rh(eye, at, up);
 
 	params->_view = view;
+
+	// Build the projection here too, so the sim can cull against the view.
+	float aspect = params->_window_height > 0 ? (float)params->_window_width / (float)params->_window_height : 1.0f;
+	params->_projection.make_perspective_rh(ga_degrees_to_radians(45.0f), aspect, 0.1f, 10000.0f);
 }
 
 void ga_camera::rotate(const ga_quatf& rotation)
@@ -28,3 +28,24 @@
 #if defined(__MINGW32__)
 #define GA_32_BIT
 #endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define GA_X86
+#endif
+
+// Instruction sets.
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define GA_SSE2
+#endif
+
+// Kernels for instruction sets past the build's baseline, only called once
+// ga_cpu has found them. MSVC allows their intrinsics anywhere; GCC and
+// Clang need each function using them marked.
+#if defined(GA_SSE2) && defined(GA_X86)
+#define GA_AVX2
+#if defined(GA_MSVC)
+#define GA_TARGET_AVX2
+#else
+#define GA_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
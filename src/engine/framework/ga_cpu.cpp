@@ -0,0 +1,180 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "ga_cpu.h"
+#include "ga_compiler_defines.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(GA_X86)
+#if defined(GA_MSVC)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+static const char* k_tier_names[] = { "scalar", "sse2", "sse41", "avx2", "avx512" };
+
+struct ga_cpu_info_t
+{
+	ga_cpu_tier _detected;
+	ga_cpu_tier _tier;
+	bool _fma;
+};
+
+static ga_cpu_info_t _detect();
+#if defined(GA_X86)
+static void _cpuid(int leaf, int subleaf, uint32_t regs[4]);
+static uint64_t _read_xcr0();
+#endif
+
+static const ga_cpu_info_t& _get_info()
+{
+	// initialized once, even if several threads get here first
+	static const ga_cpu_info_t info = _detect();
+	return info;
+}
+
+void ga_cpu::startup()
+{
+	_get_info();
+}
+
+ga_cpu_tier ga_cpu::get_tier()
+{
+	return _get_info()._tier;
+}
+
+ga_cpu_tier ga_cpu::get_detected_tier()
+{
+	return _get_info()._detected;
+}
+
+bool ga_cpu::has_fma()
+{
+	return _get_info()._fma;
+}
+
+const char* ga_cpu::get_tier_name(ga_cpu_tier tier)
+{
+	return k_tier_names[tier];
+}
+
+bool ga_cpu::parse_tier(const char* name, ga_cpu_tier* tier)
+{
+	for (int i = 0; i <= k_cpu_tier_avx512; i++)
+	{
+		if (strcmp(name, k_tier_names[i]) == 0)
+		{
+			*tier = (ga_cpu_tier) i;
+			return true;
+		}
+	}
+	return false;
+}
+
+#if defined(GA_X86)
+static void _cpuid(int leaf, int subleaf, uint32_t regs[4])
+{
+#if defined(GA_MSVC)
+	__cpuidex((int*) regs, leaf, subleaf);
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t _read_xcr0()
+{
+#if defined(GA_MSVC)
+	return _xgetbv(0);
+#else
+	uint32_t eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((uint64_t) edx << 32) | eax;
+#endif
+}
+#endif
+
+static ga_cpu_info_t _detect()
+{
+	ga_cpu_info_t info;
+	info._detected = k_cpu_tier_scalar;
+	info._fma = false;
+
+#if defined(GA_X86)
+	uint32_t regs[4];
+	_cpuid(0, 0, regs);
+	uint32_t max_leaf = regs[0];
+
+	_cpuid(1, 0, regs);
+	bool sse2 = (regs[3] & (1u << 26)) != 0;
+	bool sse41 = (regs[2] & (1u << 19)) != 0;
+	bool fma = (regs[2] & (1u << 12)) != 0;
+	bool osxsave = (regs[2] & (1u << 27)) != 0;
+	bool avx = (regs[2] & (1u << 28)) != 0;
+
+	bool avx2 = false, avx512 = false;
+	if (max_leaf >= 7)
+	{
+		_cpuid(7, 0, regs);
+		avx2 = (regs[1] & (1u << 5)) != 0;
+		avx512 = (regs[1] & (1u << 16)) != 0;
+	}
+
+	// the OS also has to save the wider registers on a context switch
+	uint64_t xcr0 = osxsave ? _read_xcr0() : 0;
+	bool os_avx = (xcr0 & 0x6) == 0x6;
+	bool os_avx512 = (xcr0 & 0xe6) == 0xe6;
+
+	info._fma = fma && avx && os_avx;
+	if (sse2)
+	{
+		info._detected = k_cpu_tier_sse2;
+	}
+	if (sse2 && sse41)
+	{
+		info._detected = k_cpu_tier_sse41;
+	}
+	if (sse41 && avx && avx2 && info._fma)
+	{
+		info._detected = k_cpu_tier_avx2;
+	}
+	if (info._detected == k_cpu_tier_avx2 && avx512 && os_avx512)
+	{
+		info._detected = k_cpu_tier_avx512;
+	}
+#endif
+
+	info._tier = info._detected;
+
+	const char* forced = getenv("GA_CPU_TIER");
+	if (forced != NULL)
+	{
+		ga_cpu_tier tier;
+		if (!ga_cpu::parse_tier(forced, &tier))
+		{
+			std::cerr << "GA_CPU_TIER: '" << forced << "' not recognized" << std::endl;
+		}
+		else if (tier > info._detected)
+		{
+			std::cerr << "GA_CPU_TIER: " << forced << " not supported, using " <<
+				k_tier_names[info._detected] << std::endl;
+		}
+		else
+		{
+			info._tier = tier;
+		}
+	}
+
+	return info;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+/*
+** Instruction set levels numeric kernels are built for, lowest first.
+** Each level includes everything below it.
+*/
+enum ga_cpu_tier
+{
+	k_cpu_tier_scalar,
+	k_cpu_tier_sse2,
+	k_cpu_tier_sse41,
+	k_cpu_tier_avx2,     // with FMA
+	k_cpu_tier_avx512,   // AVX-512F
+};
+
+/*
+** Detects the instruction sets the CPU and OS support, so hot kernels can
+** bind to the best implementation at run time.
+** Setting the GA_CPU_TIER environment variable to a tier's name (scalar,
+** sse2, sse41, avx2 or avx512) caps the tier, for benchmarking and
+** debugging the lower paths on newer hardware.
+*/
+class ga_cpu
+{
+public:
+	/*
+	** Detect the CPU's features and apply any override. Runs on first use
+	** otherwise; calling it at startup keeps detection off the hot paths.
+	*/
+	static void startup();
+
+	// the tier kernels should use
+	static ga_cpu_tier get_tier();
+
+	// the tier the hardware supports, before any override
+	static ga_cpu_tier get_detected_tier();
+
+	static bool has_fma();
+
+	static const char* get_tier_name(ga_cpu_tier tier);
+	static bool parse_tier(const char* name, ga_cpu_tier* tier);
+};
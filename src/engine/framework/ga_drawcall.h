@@ -28,6 +28,7 @@ struct ga_drawcall
 	std::string _name;
 	ga_mat4f _transform;
 	GLenum _draw_mode;
+	GLenum _index_type = GL_UNSIGNED_SHORT;
 	class ga_material* _material = 0;
 };
 
@@ -45,11 +46,13 @@ struct ga_static_drawcall : ga_drawcall
 /*
 ** Draw call with dynamic geometry.
 ** Geometry referenced by this draw call should only a single frame.
+** Indices are read from _indices32 when _index_type is GL_UNSIGNED_INT.
 */
 struct ga_dynamic_drawcall : ga_drawcall
 {
 	std::vector<ga_vec3f> _positions;
 	std::vector<ga_vec2f> _texcoords;
 	std::vector<uint16_t> _indices;
+	std::vector<uint32_t> _indices32;
 	ga_vec3f _color;
 };
@@ -55,6 +55,16 @@ enum ga_button_t
 	k_button_z		= 1 << 30,
 };
 
+/*
+** Work that has to run on the thread owning the GL context, such as
+** uploading buffers built on other threads.
+*/
+struct ga_gl_work
+{
+	void (*_entry)(void* data);
+	void* _data;
+};
+
 /*
 ** Working information for the frame.
 ** Each frame stage emits some data for consumption by later stages.
@@ -72,6 +82,9 @@ struct ga_frame_params
 	float _mouse_x;
 	float _mouse_y;
 
+	int _window_width;
+	int _window_height;
+
 	// Data emitted by sim stage:
 	std::vector<ga_static_drawcall> _static_drawcalls;
 	std::atomic_flag _static_drawcall_lock = ATOMIC_FLAG_INIT;
@@ -82,5 +95,10 @@ struct ga_frame_params
 	std::vector<ga_dynamic_drawcall> _gui_drawcalls;
 	std::atomic_flag _gui_drawcall_lock = ATOMIC_FLAG_INIT;
 
+	// run by the output stage once the frame is drawn
+	std::vector<ga_gl_work> _gl_work;
+	std::atomic_flag _gl_work_lock = ATOMIC_FLAG_INIT;
+
 	ga_mat4f _view;
+	ga_mat4f _projection;
 };
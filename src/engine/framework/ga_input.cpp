@@ -191,6 +191,8 @@ bool ga_input::update(ga_frame_params* params)
 	params->_mouse_x = _mouse_x;
 	params->_mouse_y = _mouse_y;
 
+	SDL_GetWindowSize(static_cast<SDL_Window* >(_window), &params->_window_width, &params->_window_height);
+
 	// Update time. Cap frame rate at ~60 fps.
 	auto t0 = _last_time;
 	auto t1 = std::chrono::high_resolution_clock::now();
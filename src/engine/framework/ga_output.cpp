@@ -34,6 +34,11 @@ ga_output::ga_output(void* win) : _window(win)
 	glEnable(GL_DEPTH_TEST);
 	glDepthFunc(GL_LESS);
 
+	// terrain strips separate rows with the largest index of their type
+	glEnable(GL_PRIMITIVE_RESTART);
+	_restart_index = 0xffff;
+	glPrimitiveRestartIndex(_restart_index);
+
 	_default_material = new ga_constant_color_material();
 	_default_material->init();
 }
@@ -56,9 +61,7 @@ void ga_output::update(ga_frame_params* params)
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	// Compute projection matrices:
-	ga_mat4f perspective;
-	perspective.make_perspective_rh(ga_degrees_to_radians(45.0f), (float)width / (float)height, 0.1f, 10000.0f);
-	ga_mat4f view_perspective = params->_view * perspective;
+	ga_mat4f view_perspective = params->_view * params->_projection;
 
 	ga_mat4f ortho;
 	ortho.make_orthographic(0.0f, (float)width, (float)height, 0.0f, 0.1f, 10000.0f);
@@ -71,13 +74,20 @@ void ga_output::update(ga_frame_params* params)
 	{
 		d._material->bind(view_perspective, d._transform);
 		glBindVertexArray(d._vao);
-		glDrawElements(d._draw_mode, d._index_count, GL_UNSIGNED_SHORT, 0);
+		set_restart_index(d._index_type);
+		glDrawElements(d._draw_mode, d._index_count, d._index_type, 0);
 	}
 
 	// Draw all dynamic geometry:
 	draw_dynamic(params->_dynamic_drawcalls, view_perspective);
 	draw_dynamic(params->_gui_drawcalls, view_ortho);
 
+	// Run GL work after drawing, so it can free anything this frame used:
+	for (auto& w : params->_gl_work)
+	{
+		w._entry(w._data);
+	}
+
 	GLenum error = glGetError();
 	assert(error == GL_NONE);
 
@@ -124,9 +134,20 @@ void ga_output::draw_dynamic(const std::vector<ga_dynamic_drawcall>& drawcalls,
 		GLuint indices;
 		glGenBuffers(1, &indices);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint16_t) * d._indices.size(), &d._indices[0], GL_STREAM_DRAW);
+		GLsizei index_count;
+		if (d._index_type == GL_UNSIGNED_INT)
+		{
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * d._indices32.size(), &d._indices32[0], GL_STREAM_DRAW);
+			index_count = (GLsizei)d._indices32.size();
+		}
+		else
+		{
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint16_t) * d._indices.size(), &d._indices[0], GL_STREAM_DRAW);
+			index_count = (GLsizei)d._indices.size();
+		}
 
-		glDrawElements(d._draw_mode, (GLsizei)d._indices.size(), GL_UNSIGNED_SHORT, 0);
+		set_restart_index(d._index_type);
+		glDrawElements(d._draw_mode, index_count, d._index_type, 0);
 
 		glDisableVertexAttribArray(0);
 		glDisableVertexAttribArray(1);
@@ -140,3 +161,13 @@ void ga_output::draw_dynamic(const std::vector<ga_dynamic_drawcall>& drawcalls,
 		glBindVertexArray(0);
 	}
 }
+
+void ga_output::set_restart_index(GLenum index_type)
+{
+	GLuint restart_index = index_type == GL_UNSIGNED_INT ? 0xffffffff : 0xffff;
+	if (restart_index != _restart_index)
+	{
+		_restart_index = restart_index;
+		glPrimitiveRestartIndex(_restart_index);
+	}
+}
@@ -28,8 +28,10 @@ public:
 
 private:
 	void draw_dynamic(const std::vector<ga_dynamic_drawcall>& drawcalls, const ga_mat4f& view_proj);
+	void set_restart_index(GLenum index_type);
 
 	void* _window;
+	GLuint _restart_index;
 
 	class ga_constant_color_material* _default_material;
 };
@@ -24,6 +24,9 @@
 class ga_material
 {
 public:
+	// materials are owned and deleted through this base
+	virtual ~ga_material() {}
+
 	virtual bool init() = 0;
 
 	virtual void bind(const ga_mat4f& view_proj, const ga_mat4f& transform) = 0;
@@ -4,304 +4,879 @@
 ** 
 ** Terrain generator component
 */
-#include <fstream>
 #include <cassert>
 #include <iostream>
 
 #include "ga_terrain_component.h"
+#include "ga_terrain_pipeline.h"
 #include "ga_material.h"
 
 #include "entity/ga_entity.h"
+#include "jobs/ga_job.h"
+#include "terrain/ga_terrain_chunk.h"
+#include "terrain/ga_terrain_chunk_cache.h"
+#include "terrain/ga_terrain_chunk_grid.h"
+#include "terrain/ga_terrain_chunk_pool.h"
+#include "terrain/ga_terrain_clipmap.h"
+#include "terrain/ga_terrain_field.h"
+#include "terrain/ga_terrain_task.h"
+
+#include <algorithm>
+#include <cmath>
+
+// chunks generating at once; the job queue is shared with the rest of the engine
+static const int k_max_tasks = 32;
+
+// how far each finished chunk moves the running cost averages
+static const float k_cost_smoothing = 0.1f;
+
+static std::string _get_edit_path(const std::string& edit_file);
+static void _update_cost(float* cost, float milliseconds);
 
 ga_terrain_component::ga_terrain_component( ga_entity* ent, const char* param_file,
-											ga_camera* cam, bool dynamic) : ga_component(ent, dynamic)
+											ga_camera* cam) : ga_component(ent)
 {
 	// use unlit material for simplicity
-	if (_material == NULL)
+	_material = new ga_wireframe_material();
+	_material->init();
+
+	_camera = cam;
+
+	// every chunk shares the same parameters and noise source
+	_field = new ga_terrain_field(param_file);
+
+	const ga_terrain_params& params = _field->get_params();
+	_size = params._size;
+	_width = params._width;
+	_radius = params._radius;
+	_prefetch_distance = params._prefetch_time > 0.0f ? params._prefetch_distance : 0;
+
+	// prefetched chunks can sit outside the radius, so leave room for them
+	_pieces = new ga_terrain_chunk_grid(_radius + _prefetch_distance);
+
+	_has_last_eye_position = false;
+	_velocity = { 0.0f, 0.0f };
+
+	_clipmap = NULL;
+	if (params._clipmap_levels > 0)
 	{
-		_material = new ga_wireframe_material();
-		_material->init();
+		_clipmap = new ga_terrain_clipmap(_field, params._clipmap_levels, params._clipmap_detail);
 	}
 
-	// default start at position (0, 0);
-	ga_vec3f pos = ent->get_transform().get_translation();
-	_position = { pos.x, pos.z };
-	_camera = cam;
+	// tell the material about our width; uploaded chunks draw statically,
+	// which doesn't set a color per draw
+	_material->set_width(_width / (float) _size);
+	_material->set_color({ 0.3f, 0.3f, 0.3f });
 
-	_param_file = param_file;
+	_pipeline = new ga_terrain_pipeline();
 
-	// initialize neighbors data to null
-	_parent = NULL;
+	// start the pools with what a stationary camera keeps resident, so only
+	// prefetching past that grows them
+	int resident = 0;
+	if (_clipmap == NULL)
+	{
+		for (int i = -_radius; i < _radius; i++)
+		{
+			for (int j = -_radius; j < _radius; j++)
+			{
+				resident += i * i + j * j < _radius * _radius ? 1 : 0;
+			}
+		}
+		resident += k_max_tasks;
+	}
+	_chunk_pool = new ga_terrain_chunk_pool(_field, resident);
 
-	// load the input file
-	extern char g_root_path[256];
-	std::string fullpath = g_root_path;
-	fullpath += param_file;
+	_edit_layer = new ga_terrain_edit_layer(_field);
+	if (!params._edit_file.empty())
+	{
+		// a missing file just means nothing has been edited yet
+		_edit_layer->load(_get_edit_path(params._edit_file).c_str());
+	}
+	_brush_op = -1;
+	_brush_height = 0.0f;
+	_flow = new ga_terrain_flow(_field);
+
+	_chunk_cache = NULL;
+	if (_clipmap == NULL && params._cache_budget > 0)
+	{
+		_chunk_cache = new ga_terrain_chunk_cache(params._cache_budget * 1024, params._cache_bits);
+	}
 
-	std::ifstream file(fullpath);
+	_free_tasks.reserve(k_max_tasks);
+	_tasks.reserve(k_max_tasks);
+	for (int i = 0; i < (_clipmap == NULL ? k_max_tasks : 0); i++)
+	{
+		_free_tasks.push_back(new ga_terrain_task(0, 0, NULL, 0, false));
+	}
+
+	_scheduler.set_budget(params._frame_budget);
+	_pipeline->set_upload_budget(params._frame_budget);
+	_generate_cost_ms = 0.0f;
+	_restore_cost_ms = 0.0f;
+
+	_stats = {};
+	_last_sampled = 0;
+	_last_meshed = 0;
+	_last_uploaded = 0;
+	_last_stalled = 0;
+}
 
-	assert(file.is_open());
+ga_terrain_component::~ga_terrain_component()
+{
+	// stop the workers before freeing what they're working on
+	_pipeline->shutdown();
+	for (ga_terrain_task* task : _tasks)
+	{
+		_chunk_pool->free(task->release_chunk());
+		delete task;
+	}
+	for (ga_terrain_task* task : _free_tasks)
+	{
+		delete task;
+	}
 
-	// now assign parameters based on the input
-	std::string cmd;
-	while (file.peek() != EOF)
+	for (int i = 0; i < _pieces->get_slot_count(); i++)
 	{
-		file >> cmd;
-		if (cmd == "detail")
+		ga_terrain_chunk* chunk = _pieces->get_slot(i)._chunk;
+		if (chunk != NULL)
 		{
-			file >> _size;
-			// for convenience use 2^x + 1
-			_size = std::pow(2, _size) + 1;
+			_chunk_pool->free(chunk);
 		}
-		else if (cmd == "width")
+	}
+
+	// every chunk is back in the pool, holding on to its GPU mesh
+	for (ga_terrain_chunk* chunk : _chunk_pool->get_free())
+	{
+		ga_terrain_pipeline::free_gpu_mesh(chunk->get_gpu_mesh());
+	}
+
+	const std::string& edit_file = _field->get_params()._edit_file;
+	if (!edit_file.empty())
+	{
+		_edit_layer->save(_get_edit_path(edit_file).c_str());
+	}
+
+	delete _chunk_cache;
+	delete _flow;
+	delete _edit_layer;
+	delete _chunk_pool;
+	delete _pipeline;
+
+	delete _pieces;
+	delete _clipmap;
+	delete _field;
+	delete _material;
+}
+
+ga_terrain_chunk* ga_terrain_component::find_chunk(float x, float z) const
+{
+	// chunks are centered on multiples of the width
+	int chunk_x = (int) std::floor(x / _width + 0.5f);
+	int chunk_z = (int) std::floor(z / _width + 0.5f);
+
+	return _pieces->find(chunk_x, chunk_z);
+}
+
+float ga_terrain_component::get_height(float x, float z) const
+{
+	ga_terrain_chunk* chunk = find_chunk(x, z);
+	if (chunk != NULL)
+	{
+		return chunk->sample_height(x, z);
+	}
+	return _field->get_height(x, z) + _edit_layer->sample(x, z);
+}
+
+void ga_terrain_component::get_heights(const float* x, const float* z, float* heights, int count) const
+{
+	// positions without a resident chunk are gathered and sent to the field in blocks
+	const int k_block = 64;
+	float miss_x[k_block], miss_z[k_block], miss_heights[k_block];
+	int miss_index[k_block];
+	int miss_count = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		ga_terrain_chunk* chunk = find_chunk(x[i], z[i]);
+		if (chunk != NULL)
 		{
-			file >> _width;
+			heights[i] = chunk->sample_height(x[i], z[i]);
+			continue;
 		}
-		else if (cmd == "height")
+
+		miss_x[miss_count] = x[i];
+		miss_z[miss_count] = z[i];
+		miss_index[miss_count] = i;
+		miss_count++;
+
+		if (miss_count == k_block)
 		{
-			file >> _height;
+			_field->get_heights(miss_x, miss_z, miss_heights, miss_count);
+			for (int m = 0; m < miss_count; m++)
+			{
+				heights[miss_index[m]] = miss_heights[m] + _edit_layer->sample(miss_x[m], miss_z[m]);
+			}
+			miss_count = 0;
 		}
-		else if (cmd == "radius")
+	}
+
+	if (miss_count > 0)
+	{
+		_field->get_heights(miss_x, miss_z, miss_heights, miss_count);
+		for (int m = 0; m < miss_count; m++)
 		{
-			file >> _radius;
+			heights[miss_index[m]] = miss_heights[m] + _edit_layer->sample(miss_x[m], miss_z[m]);
 		}
-		else
+	}
+}
+
+bool ga_terrain_component::raycast(const ga_vec3f& origin, const ga_vec3f& dir, float max_distance, ga_terrain_ray_hit* hit) const
+{
+	hit->_hit = _pieces->raycast(origin, dir, _width, max_distance, &hit->_t);
+	if (hit->_hit)
+	{
+		hit->_position = origin + dir.scale_result(hit->_t);
+	}
+
+	return hit->_hit;
+}
+
+void ga_terrain_component::raycast(const ga_vec3f* origins, const ga_vec3f* dirs, float max_distance, ga_terrain_ray_hit* hits, int count) const
+{
+	// split the rays into at most k_max_jobs jobs of at least k_min_rays each
+	const int k_min_rays = 64;
+	const int k_max_jobs = 64;
+
+	int job_count = (count + k_min_rays - 1) / k_min_rays;
+	job_count = job_count > k_max_jobs ? k_max_jobs : job_count;
+	if (job_count <= 1)
+	{
+		for (int i = 0; i < count; i++)
 		{
-			// Unknown input, error
-			std::cerr << "Error parsing terrain file: '" << cmd <<
-				"' not recognized" << std::endl;
-			assert(false);
+			raycast(origins[i], dirs[i], max_distance, &hits[i]);
 		}
+		return;
 	}
 
-	// tell the material about our width
-	_material->set_width(_width / (float) _size);
+	struct raycast_data_t
+	{
+		const ga_terrain_component* _terrain;
+		const ga_vec3f* _origins;
+		const ga_vec3f* _dirs;
+		ga_terrain_ray_hit* _hits;
+		int _count;
+		float _max_distance;
+	};
 
-	// and finally, generate a heightmap from our parameters
-	_points = new float[_size * _size];
+	std::vector<ga_job_decl_t> decls(job_count);
+	std::vector<raycast_data_t> data(job_count);
 
-	// initialize the terrain points and mesh if this is a static terrain
-	if (!dynamic)
+	int rays_per_job = (count + job_count - 1) / job_count;
+	for (int i = 0; i < job_count; i++)
 	{
-		init();
+		int start = i * rays_per_job;
+		int end = start + rays_per_job > count ? count : start + rays_per_job;
+
+		data[i]._terrain = this;
+		data[i]._origins = origins + start;
+		data[i]._dirs = dirs + start;
+		data[i]._hits = hits + start;
+		data[i]._count = end > start ? end - start : 0;
+		data[i]._max_distance = max_distance;
+
+		decls[i]._data = &data[i];
+		decls[i]._entry = [](void* data)
+		{
+			auto rays = static_cast<raycast_data_t*>(data);
+			for (int r = 0; r < rays->_count; r++)
+			{
+				rays->_terrain->raycast(rays->_origins[r], rays->_dirs[r], rays->_max_distance, &rays->_hits[r]);
+			}
+		};
 	}
+
+	int32_t counter;
+	ga_job::run(&decls[0], job_count, &counter);
+	ga_job::wait(&counter);
 }
 
-void ga_terrain_component::init()
+void ga_terrain_component::update(ga_frame_params * params)
 {
-	// initialize the actual heightmap
-	generate_terrain();
-
-	// use the newly generated _points to setup vertices for drawing
-	setup_vertices();
-
-	// add this to the list of active terrain pieces
-	std::pair<int, int> pos = std::make_pair(
-		(int) _position.x / (int) _width,
-		(int) _position.y / (int) _width
-	);
-	_pieces[pos] = this;
+	if (_clipmap != NULL)
+	{
+		draw_clipmap(params);
+	}
+	else
+	{
+		apply_brush_keys(params);
+		draw_chunks(params);
+	}
 }
 
-void ga_terrain_component::generate_terrain()
+void ga_terrain_component::draw_chunks(ga_frame_params* params)
 {
-	// initialize points pseudorandomly with Perlin noise
-	for (int i = 0; i < _size; i++)
+	// test every loaded chunk against the view in one batch
+	_culler.set_view_projection(params->_view * params->_projection);
+	_culler.clear();
+	_cull_chunks.clear();
+
+	for (int i = 0; i < _pieces->get_slot_count(); i++)
+	{
+		ga_terrain_chunk* chunk = _pieces->get_slot(i)._chunk;
+		if (chunk != NULL)
+		{
+			_cull_chunks.push_back(chunk);
+			_culler.add_box(chunk->get_min(), chunk->get_max());
+		}
+	}
+
+	_culler.cull();
+
+	_stats._loaded = _culler.get_count();
+	_stats._frustum_culled = _culler.get_count() - _culler.get_visible_count();
+	_stats._occlusion_culled = 0;
+	_stats._drawn = 0;
+
+	// sort the survivors front to back so nearer ridges can hide farther chunks
+	ga_vec3f eye = _camera->get_transform().get_translation();
+	_draw_order.clear();
+	for (int i = 0; i < _culler.get_count(); i++)
 	{
-		for (int j = 0; j < _size; j++)
+		if (_culler.is_visible(i))
 		{
-			ga_vec2f pos = point_to_position(i, j) + _position;
-			float x = pos.x;
-			float y = pos.y;
+			ga_vec3f center = (_cull_chunks[i]->get_min() + _cull_chunks[i]->get_max()).scale_result(0.5f);
+			float dx = center.x - eye.x;
+			float dz = center.z - eye.z;
+			_draw_order.push_back(std::make_pair(dx * dx + dz * dz, _cull_chunks[i]));
+		}
+	}
+	std::sort(_draw_order.begin(), _draw_order.end());
+
+	_horizon.begin(params->_view * params->_projection, eye);
+	bool occlusion = _field->get_params()._occlusion;
 
-			set_point(i, j, noise(x, y, 0.5f));
+	// draw only the visible chunks; every loaded chunk has been uploaded,
+	// in view first, so turning the camera never waits on an upload
+	for (auto& entry : _draw_order)
+	{
+		ga_terrain_chunk* chunk = entry.second;
+		if (occlusion)
+		{
+			if (_horizon.is_occluded(chunk->get_min(), chunk->get_max()))
+			{
+				_stats._occlusion_culled++;
+				continue;
+			}
+			_horizon.add_occluder(chunk->get_min(), chunk->get_max());
 		}
+
+		draw_chunk(params, chunk);
+		_stats._drawn++;
 	}
 }
 
-// Perlin noise generator - based on the reference implementation at 
-// http://mrl.nyu.edu/~perlin/noise/
-float ga_terrain_component::noise(float x, float y, float z)
+void ga_terrain_component::draw_chunk(ga_frame_params* params, const ga_terrain_chunk* chunk)
 {
-	int X = (int)std::floor(x) & 255,                  // FIND UNIT CUBE THAT
-		Y = (int)std::floor(y) & 255,                  // CONTAINS POINT.
-		Z = (int)std::floor(z) & 255;
-
-	x -= std::floor(x);                                // FIND RELATIVE X,Y,Z
-	y -= std::floor(y);                                // OF POINT IN CUBE.
-	z -= std::floor(z);
-
-	double  u = fade(x),                                // COMPUTE FADE CURVES
-			v = fade(y),                                // FOR EACH OF X,Y,Z.
-			w = fade(z);
-
-	int A = get_p(X  ) + Y, AA = get_p(A) + Z, AB = get_p(A + 1) + Z,      // HASH COORDINATES OF
-		B = get_p(X+1) + Y, BA = get_p(B) + Z, BB = get_p(B + 1) + Z;      // THE 8 CUBE CORNERS,
-
-	return lerp(w, lerp(v, lerp(u,  grad(get_p(AA  ), x  , y  , z  ),  // AND ADD
-									grad(get_p(BA  ), x-1, y  , z  )), // BLENDED
-							lerp(u, grad(get_p(AB  ), x  , y-1, z  ),  // RESULTS
-									grad(get_p(BB  ), x-1, y-1, z  ))),// FROM  8
-					lerp(v, lerp(u, grad(get_p(AA+1), x  , y  , z-1),  // CORNERS
-									grad(get_p(BA+1), x-1, y  , z-1)), // OF CUBE
-							lerp(u, grad(get_p(AB+1), x  , y-1, z-1),
-									grad(get_p(BB+1), x-1, y-1, z-1))));
+	// loaded chunks have always been through the upload stage
+	const ga_terrain_gpu_mesh* mesh = chunk->get_gpu_mesh();
+	assert(mesh != NULL);
+
+	ga_static_drawcall draw;
+	draw._name = "ga_terrain_component";
+	draw._vao = mesh->_vao;
+	draw._index_count = mesh->_index_count;
+	draw._index_type = mesh->_index_type;
+	draw._transform = get_entity()->get_transform();
+	draw._draw_mode = mesh->_draw_mode;
+	draw._material = _material;
+
+	while (params->_static_drawcall_lock.test_and_set(std::memory_order_acquire)) {}
+	params->_static_drawcalls.push_back(draw);
+	params->_static_drawcall_lock.clear(std::memory_order_release);
 }
 
-float ga_terrain_component::grad(int hash, float x, float y, float z)
+void ga_terrain_component::draw_clipmap(ga_frame_params* params)
 {
-	int h = hash & 15;                      // CONVERT LO 4 BITS OF HASH CODE
-	double u = h<8 ? x : y,                 // INTO 12 GRADIENT DIRECTIONS.
-		v = h<4 ? y : h == 12 || h == 14 ? x : z;
-	return ((h & 1) == 0 ? u : -u) + ((h & 2) == 0 ? v : -v);
+	_stats._loaded = _clipmap->get_level_count();
+	_stats._frustum_culled = 0;
+	_stats._occlusion_culled = 0;
+	_stats._drawn = 0;
+
+	// every ring surrounds the camera, so there is nothing worth culling
+	for (int l = 0; l < _clipmap->get_level_count(); l++)
+	{
+		ga_dynamic_drawcall draw;
+		draw._name = "ga_terrain_component";
+		draw._transform = get_entity()->get_transform();
+		draw._draw_mode = GL_TRIANGLES;
+		draw._material = _material;
+		draw._positions = _clipmap->get_vertices(l);
+		draw._indices = _clipmap->get_indices(l);
+		draw._color = { 0.3f, 0.3f, 0.3f };
+
+		while (params->_dynamic_drawcall_lock.test_and_set()) {}
+		params->_dynamic_drawcalls.push_back(draw);
+		params->_dynamic_drawcall_lock.clear(std::memory_order_release);
+
+		_stats._drawn++;
+	}
 }
 
-// initialization vector for Perlin noise
-const int ga_terrain_component::get_permutation(int i)
+void ga_terrain_component::print_stats(ga_frame_params* params)
 {
-	static const int permutation[] = 
-	{
-		151,160,137,91,90,15,
-		131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,8,99,37,240,21,10,23,
-		190, 6,148,247,120,234,75,0,26,197,62,94,252,219,203,117,35,11,32,57,177,33,
-		88,237,149,56,87,174,20,125,136,171,168, 68,175,74,165,71,134,139,48,27,166,
-		77,146,158,231,83,111,229,122,60,211,133,230,220,105,92,41,55,46,245,40,244,
-		102,143,54, 65,25,63,161, 1,216,80,73,209,76,132,187,208, 89,18,169,200,196,
-		135,130,116,188,159,86,164,100,109,198,173,186, 3,64,52,217,226,250,124,123,
-		5,202,38,147,118,126,255,82,85,212,207,206,59,227,47,16,58,17,182,189,28,42,
-		223,183,170,213,119,248,152, 2,44,154,163, 70,221,153,101,155,167, 43,172,9,
-		129,22,39,253, 19,98,108,110,79,113,224,232,178,185, 112,104,218,246,97,228,
-		251,34,242,193,238,210,144,12,191,179,162,241, 81,51,145,235,249,14,239,107,
-		49,192,214, 31,181,199,106,157,184, 84,204,176,115,121,50,45,127, 4,150,254,
-		138,236,205,93,222,114,67,29,24,72,243,141,128,195,78,66,215,61,156,180
-	};
+	if (!_field->get_params()._stats ||
+		params->_current_time - _last_stats_time < std::chrono::seconds(1))
+	{
+		return;
+	}
+	_last_stats_time = params->_current_time;
 
-	return permutation[i];
+	std::cout << "terrain: " << _stats._loaded << " loaded, " <<
+		_stats._drawn << " drawn, " <<
+		_stats._frustum_culled << " frustum culled, " <<
+		_stats._occlusion_culled << " occlusion culled, " <<
+		_stats._generated << " samples generated, " <<
+		_stats._queued << " queued, " <<
+		_stats._latency_ms << " ms latency";
+
+	int entered = _stats._prefetch_hits + _stats._prefetch_misses;
+	if (_prefetch_distance > 0 && entered > 0)
+	{
+		std::cout << ", " << 100 * _stats._prefetch_hits / entered << "% prefetch hits, " <<
+			_stats._prefetch_wasted << " prefetches wasted";
+	}
+	std::cout << ", " << _stats._sampled << " sampled, " <<
+		_stats._meshed << " meshed, " <<
+		_stats._uploaded << " uploaded, " <<
+		_stats._stalled << " stalls";
+	if (_stats._cancelled > 0)
+	{
+		std::cout << ", " << _stats._cancelled << " jobs cancelled (" <<
+			_stats._cancelled_samples << " samples wasted)";
+	}
+	if (_chunk_cache != NULL && _stats._cached_bytes > 0)
+	{
+		float raw_bytes = (float) _stats._cached * _size * _size * sizeof(float);
+		std::cout << ", " << _stats._cached << " cached (" <<
+			_stats._cached_bytes / 1024 << " KB, " <<
+			raw_bytes / _stats._cached_bytes << ":1), " <<
+			_stats._restored << " restored (" <<
+			_stats._restore_ms << " ms each)";
+	}
+	std::cout << std::endl;
 }
 
-// Helper for Perlin noise initialization vector
-const int ga_terrain_component::get_p(int i)
+void ga_terrain_component::late_update(ga_frame_params* params)
 {
-	if (i < 256)
+	// get the camera position to determine whether we need to generate new terrain
+	ga_vec3f eye_position = _camera->get_transform().get_translation();
+
+	if (_clipmap != NULL)
+	{
+		_stats._generated = _clipmap->update(eye_position.x, eye_position.z);
+	}
+	else
 	{
-		return get_permutation(i);
+		stream_chunks(params, eye_position);
+		refine_chunks(eye_position);
+		_pipeline->queue_gl_work(params);
 	}
-	return get_permutation(i - 256);
+
+	print_stats(params);
 }
 
-void ga_terrain_component::setup_vertices()
+void ga_terrain_component::stream_chunks(ga_frame_params* params, ga_vec3f eye_position)
 {
-	// setup indices and vertices for drawing
-	int vertex_count = 3 * _size * _size;
+	update_velocity(params, eye_position);
+	_stats._generated = 0;
+
+	// take in finished chunks, and call off the ones no longer wanted
+	std::set<std::pair<int, int> > wanted = build_neighbors(eye_position);
+	collect_tasks(wanted);
 
-	// calculate x, y, z from _points data
-	for (int i = 0; i < _size; i++)
+	// queue new terrain as needed, most important first and prefetches last
+	_scheduler.begin_frame(wanted);
+	float prefetch_priority = (float) (16 * (_radius + _prefetch_distance) * (_radius + _prefetch_distance));
+	for (ga_terrain_request& request : _scheduler.get_requests())
 	{
-		for (int j = 0; j < _size; j++)
+		request._priority = get_priority(request._x, request._z, eye_position);
+		if (_prefetch_cone.count(std::make_pair(request._x, request._z)) != 0)
 		{
-			ga_vec2f pos = point_to_position(i, j) + _position;
-			float y = get_point(i, j) * _height - _height / 2.0f;
+			request._priority += prefetch_priority;
+		}
+	}
+	_scheduler.sort();
 
-			_vertices.push_back({ pos.x, y, pos.y });
+	// and feed the pipeline as much as it takes, as coarse previews if asked
+	// for; a full noise queue means the later stages are behind, so wait.
+	// The work happens on the workers, so each chunk is charged what chunks
+	// like it have cost them lately
+	int preview_levels = _field->get_params()._preview_levels;
+
+	ga_terrain_request request;
+	while ((int) _tasks.size() < k_max_tasks && _pipeline->can_submit() && _scheduler.next(&request))
+	{
+		bool prefetch = _prefetch_cone.count(std::make_pair(request._x, request._z)) != 0;
+		ga_terrain_chunk* chunk = _chunk_pool->alloc(request._x, request._z);
+
+		ga_terrain_task* task = _free_tasks.back();
+		_free_tasks.pop_back();
+		task->reset(request._x, request._z, chunk, preview_levels, prefetch);
+		chunk->set_edits(_edit_layer->find(request._x, request._z));
+		if (_chunk_cache != NULL)
+		{
+			_chunk_cache->take(request._x, request._z, task->get_cached());
 		}
+		_scheduler.charge(task->get_cached().empty() ? _generate_cost_ms : _restore_cost_ms);
+		_pipeline->submit(task);
+		_tasks.push_back(task);
 	}
+	_pipeline->kick();
+
+	_stats._queued = _scheduler.get_queued() + (int) _tasks.size();
+	_stats._latency_ms = _scheduler.get_latency_ms();
 
-	// assign indices based on position in vertex array
-	int index_count = 6 * (_size - 1) * (_size - 1);
+	// and how far each stage got since last frame
+	_stats._sampled = _pipeline->get_sampled() - _last_sampled;
+	_stats._meshed = _pipeline->get_meshed() - _last_meshed;
+	_stats._uploaded = _pipeline->get_uploaded() - _last_uploaded;
+	_stats._stalled = _pipeline->get_stalled() - _last_stalled;
+	_last_sampled = _pipeline->get_sampled();
+	_last_meshed = _pipeline->get_meshed();
+	_last_uploaded = _pipeline->get_uploaded();
+	_last_stalled = _pipeline->get_stalled();
+}
+
+void ga_terrain_component::collect_tasks(std::set<std::pair<int, int> >& wanted)
+{
+	_stats._restored = 0;
+	_stats._restore_ms = 0.0f;
+
+	for (ga_terrain_task* task : _tasks)
+	{
+		// still wanted chunks aren't requested again while in flight
+		std::pair<int, int> key = std::make_pair(task->get_x(), task->get_z());
+		if (!task->is_cancelled() && wanted.erase(key) == 0)
+		{
+			task->cancel();
+		}
+	}
 
-	int x = 0;
-	int y = 0;
-	for (int i = 0; i < index_count; i += 6)
+	ga_terrain_task* task;
+	while (_pipeline->pop_done(&task))
 	{
-		// assign one quad at a time
-		_indices.push_back(x + _size * y);
-		_indices.push_back(x + 1 + _size * y);
-		_indices.push_back(x + 1 + _size * (y + 1));
-		_indices.push_back(x + 1 + _size * (y + 1));
-		_indices.push_back(x + _size * (y + 1));
-		_indices.push_back(x + _size * y);
+		std::pair<int, int> key = std::make_pair(task->get_x(), task->get_z());
+		if (task->is_cancelled())
+		{
+			_stats._cancelled++;
+			_stats._cancelled_samples += task->get_generated();
+			_chunk_pool->free(task->release_chunk());
 
-		// advance coordinates to keep up
-		x = (x + 1);
-		if (x >= _size - 1)
+			// the compressed chunk is still good for the next time it's wanted,
+			// unless an edit has changed it since
+			if (_chunk_cache != NULL && !task->get_cached().empty() && !task->is_outdated())
+			{
+				_chunk_cache->restore(key.first, key.second, task->get_cached());
+			}
+		}
+		else
 		{
-			x = 0;
-			y++;
+			ga_terrain_chunk* chunk = task->release_chunk();
+			_pieces->insert(key.first, key.second, chunk);
+			_stats._generated += task->get_generated();
+			_update_cost(task->get_cached().empty() ? &_generate_cost_ms : &_restore_cost_ms, task->get_work_ms());
+
+			// it was generated with offsets from before the latest edits
+			if (task->is_outdated())
+			{
+				chunk->set_edits(_edit_layer->find(key.first, key.second));
+				_remesh.push_back(chunk);
+			}
+			if (!task->get_cached().empty())
+			{
+				_stats._restored++;
+				_stats._restore_ms += task->get_decode_ms();
+			}
+
+			if (task->is_prefetch())
+			{
+				_prefetched.insert(key);
+			}
+			else
+			{
+				_stats._prefetch_misses++;
+			}
 		}
+
+		_tasks.erase(std::find(_tasks.begin(), _tasks.end(), task));
+		_free_tasks.push_back(task);
+	}
+
+	if (_stats._restored > 0)
+	{
+		_stats._restore_ms /= (float) _stats._restored;
 	}
+
+	remesh_chunks();
 }
 
-ga_terrain_component::~ga_terrain_component()
+void ga_terrain_component::edit(const ga_terrain_brush& brush)
 {
-	delete[] _points;
+	if (_clipmap != NULL)
+	{
+		std::cerr << "Terrain edits aren't supported in clipmap mode" << std::endl;
+		return;
+	}
+
+	// only chunks holding a changed sample need anything done; a stroke
+	// reaching an edge changes the samples both chunks share
+	_touched.clear();
+	_edit_layer->apply(brush, _pieces, _touched);
+
+	// compressed chunks hold the heights under the edits, so they stay good
+	for (const std::pair<int, int>& key : _touched)
+	{
+		ga_terrain_chunk* chunk = _pieces->find(key.first, key.second);
+		if (chunk != NULL)
+		{
+			chunk->set_edits(_edit_layer->find(key.first, key.second));
+			_remesh.push_back(chunk);
+		}
+	}
 
-	if (_parent == NULL)
+	// chunks still in the pipeline are fixed up when they come out of it
+	for (ga_terrain_task* task : _tasks)
 	{
-		// TODO need to delete material eventually
-		// delete _material;
+		if (_touched.count(std::make_pair(task->get_x(), task->get_z())) != 0)
+		{
+			task->set_outdated();
+		}
 	}
+
+	remesh_chunks();
 }
 
-// getter/setter for _points
-float ga_terrain_component::get_point(int x, int y)
+void ga_terrain_component::apply_brush_keys(ga_frame_params* params)
 {
-	if (y * _size + x < _size * _size)
-		return _points[y * _size + x];
+	// in the order of ga_terrain_brush_op
+	const uint64_t k_brush_buttons[] = { k_button_r, k_button_f, k_button_g, k_button_t };
+
+	int op = -1;
+	for (int b = 0; b < 4 && op < 0; b++)
+	{
+		op = (params->_button_mask & k_brush_buttons[b]) ? b : -1;
+	}
+	if (op < 0)
+	{
+		_brush_op = -1;
+		return;
+	}
+
+	// brush wherever the camera is looking
+	const ga_mat4f& transform = _camera->get_transform();
+	ga_terrain_ray_hit hit;
+	if (!raycast(transform.get_translation(), transform.get_forward(), _radius * _width, &hit))
+	{
+		return;
+	}
+
+	// a new flatten stroke levels to the height it started at
+	if (op != _brush_op)
+	{
+		_brush_op = op;
+		_brush_height = hit._position.y;
+	}
+
+	float dt = std::chrono::duration_cast<std::chrono::duration<float>>(params->_delta_time).count();
+
+	ga_terrain_brush brush;
+	brush._op = (ga_terrain_brush_op) op;
+	brush._x = hit._position.x;
+	brush._z = hit._position.z;
+	brush._radius = 4.0f * _width / (float) (_size - 1);
+	brush._height = _brush_height;
+
+	// raising and lowering move a quarter of the field's height a second;
+	// smoothing and flattening get most of the way there in half a second
+	if (brush._op == k_brush_raise || brush._op == k_brush_lower)
+	{
+		brush._strength = 0.25f * (float) _field->get_params()._height * dt;
+	}
 	else
-		return 0.5f;
+	{
+		brush._strength = std::min(4.0f * dt, 1.0f);
+	}
+
+	edit(brush);
+}
+
+void ga_terrain_component::remesh_chunks()
+{
+	const int k_max_jobs = 64;
+	ga_job_decl_t decls[k_max_jobs];
+
+	for (size_t first = 0; first < _remesh.size(); first += k_max_jobs)
+	{
+		int job_count = std::min((int) (_remesh.size() - first), k_max_jobs);
+		for (int i = 0; i < job_count; i++)
+		{
+			decls[i]._data = _remesh[first + i];
+			decls[i]._entry = [](void* data)
+			{
+				auto chunk = static_cast<ga_terrain_chunk*>(data);
+				chunk->build_bounds();
+				chunk->build_mesh();
+			};
+		}
+
+		// drawing only reads the GPU copies, which change on reupload
+		int32_t counter;
+		ga_job::run(decls, job_count, &counter);
+		ga_job::wait(&counter);
+	}
+
+	for (ga_terrain_chunk* chunk : _remesh)
+	{
+		_pipeline->reupload(chunk);
+	}
+	_remesh.clear();
 }
 
-void ga_terrain_component::set_point(int x, int y, float height)
+const ga_terrain_flow& ga_terrain_component::compute_flow()
 {
-	assert(y * _size + x < _size * _size);
-	_points[y * _size + x] = height;
+	_flow_chunks.clear();
+	for (int i = 0; i < _pieces->get_slot_count(); i++)
+	{
+		ga_terrain_chunk* chunk = _pieces->get_slot(i)._chunk;
+		if (chunk != NULL)
+		{
+			_flow_chunks.push_back(chunk);
+		}
+	}
+	int tile_count = _flow->begin(_flow_chunks);
+
+	// only the outlet graph between chunks is walked serially
+	run_flow_stage(tile_count, [](void* data)
+	{
+		auto tile = static_cast<std::pair<ga_terrain_flow*, int>*>(data);
+		tile->first->route_tile(tile->second);
+	});
+	_flow->stitch();
+	run_flow_stage(tile_count, [](void* data)
+	{
+		auto tile = static_cast<std::pair<ga_terrain_flow*, int>*>(data);
+		tile->first->finish_tile(tile->second);
+	});
+
+	return *_flow;
 }
 
-ga_vec2f ga_terrain_component::point_to_position(int x, int y)
+void ga_terrain_component::run_flow_stage(int tile_count, ga_job_function_t entry)
 {
-	ga_vec2f pos;
-	pos.x = _width * ((float) x / (float) (_size - 1) - 0.5f);
-	pos.y = _width * ((float) y / (float) (_size - 1) - 0.5f);
+	const int k_max_jobs = 64;
+	ga_job_decl_t decls[k_max_jobs];
+	std::pair<ga_terrain_flow*, int> tiles[k_max_jobs];
 
-	return pos;
+	for (int first = 0; first < tile_count; first += k_max_jobs)
+	{
+		int job_count = std::min(tile_count - first, k_max_jobs);
+		for (int i = 0; i < job_count; i++)
+		{
+			tiles[i] = std::make_pair(_flow, first + i);
+			decls[i]._data = &tiles[i];
+			decls[i]._entry = entry;
+		}
+
+		int32_t counter;
+		ga_job::run(decls, job_count, &counter);
+		ga_job::wait(&counter);
+	}
 }
 
-void ga_terrain_component::update(ga_frame_params * params)
+float ga_terrain_component::get_priority(int x, int z, const ga_vec3f& eye_position) const
 {
+	// distance in chunks, with everything in view ahead of everything out of it
+	float dx = x - eye_position.x / _width;
+	float dz = z - eye_position.z / _width;
+	float priority = dx * dx + dz * dz;
 
-	// draw the terrain each frame
-	ga_dynamic_drawcall draw;
-	draw._name = "ga_terrain_component";
-	draw._transform = get_entity()->get_transform();
-	draw._draw_mode = GL_TRIANGLES;
-	draw._material = _material;
-	draw._positions = _vertices;
-	draw._indices = _indices;
-	draw._color = { 0.3f, 0.3f, 0.3f };
+	// the chunk isn't generated yet, so bound it by the field's full height range
+	float half_height = _field->get_params()._height * 0.5f;
+	ga_vec3f min = { (x - 0.5f) * _width, -half_height, (z - 0.5f) * _width };
+	ga_vec3f max = { (x + 0.5f) * _width, half_height, (z + 0.5f) * _width };
+	if (!_culler.is_box_visible(min, max))
+	{
+		priority += (float) (4 * _radius * _radius);
+	}
 
-	while (params->_dynamic_drawcall_lock.test_and_set()) {}
-	params->_dynamic_drawcalls.push_back(draw);
-	params->_dynamic_drawcall_lock.clear(std::memory_order_release);
+	return priority;
 }
 
-void ga_terrain_component::late_update(ga_frame_params* params)
+void ga_terrain_component::refine_chunks(ga_vec3f eye_position)
 {
-	// get the camera position to determine whether we need to generate new chunks
-	ga_vec3f eye_position = _camera->get_transform().get_translation();
+	// new chunks come first; refinement only gets what they left of the budget
+	if (!_scheduler.has_time())
+	{
+		return;
+	}
 
-	// add new terrain as needed 
-	std::set<std::pair<int, int> > to_generate = build_neighbors(eye_position);
+	// refine the nearest previews first, one level each
+	_refine_order.clear();
+	for (int i = 0; i < _pieces->get_slot_count(); i++)
+	{
+		ga_terrain_chunk* chunk = _pieces->get_slot(i)._chunk;
+		if (chunk != NULL && !chunk->is_refined())
+		{
+			ga_vec3f center = (chunk->get_min() + chunk->get_max()).scale_result(0.5f);
+			float dx = center.x - eye_position.x;
+			float dz = center.z - eye_position.z;
+			_refine_order.push_back(std::make_pair(dx * dx + dz * dz, chunk));
+		}
+	}
+
+	const int k_max_jobs = 64;
+	int job_count = std::min((int) _refine_order.size(), _field->get_params()._refine_budget);
+	job_count = std::min(job_count, k_max_jobs);
+	if (job_count <= 0)
+	{
+		return;
+	}
+	std::partial_sort(_refine_order.begin(), _refine_order.begin() + job_count, _refine_order.end());
+
+	struct refine_data_t
+	{
+		ga_terrain_chunk* _chunk;
+		int _generated;
+	};
 
-	auto itr = to_generate.begin();
-	while (itr != to_generate.end())
+	ga_job_decl_t decls[k_max_jobs];
+	refine_data_t data[k_max_jobs];
+	for (int i = 0; i < job_count; i++)
 	{
-		ga_terrain_component* neighbor = new ga_terrain_component(
-			get_entity(), _param_file, _camera, true
-		);
-		neighbor->_position.x = itr->first * _width;
-		neighbor->_position.y = itr->second * _width;
-		neighbor->init();
-		itr++;
+		data[i]._chunk = _refine_order[i].second;
+		data[i]._generated = 0;
+
+		decls[i]._data = &data[i];
+		decls[i]._entry = [](void* data)
+		{
+			// refine() without the bounds and mesh, for erosion to go between
+			auto refine = static_cast<refine_data_t*>(data);
+			refine->_generated = refine->_chunk->sample_refinement();
+			ga_terrain_pipeline::erode(refine->_chunk);
+			refine->_chunk->build_bounds();
+			refine->_chunk->build_mesh();
+		};
+	}
+
+	// chunks are only drawn during update, so they're free to change here
+	int32_t counter;
+	ga_job::run(decls, job_count, &counter);
+	ga_job::wait(&counter);
+
+	for (int i = 0; i < job_count; i++)
+	{
+		_stats._generated += data[i]._generated;
+		_pipeline->reupload(data[i]._chunk);
 	}
 }
 
@@ -317,40 +892,191 @@ std::set<std::pair<int, int> > ga_terrain_component::build_neighbors(ga_vec3f ey
 	{
 		for (int j = -_radius; j < _radius; j++)
 		{
-			std::pair<int, int> new_pos = std::make_pair(chunk_x + i, chunk_z + j);
-			if (i * i + j * j < _radius * _radius &&
-				_pieces.find(new_pos) == _pieces.end())
+			if (i * i + j * j >= _radius * _radius)
+			{
+				continue;
+			}
+
+			std::pair<int, int> key = std::make_pair(chunk_x + i, chunk_z + j);
+			if (_pieces->find(key.first, key.second) == NULL)
+			{
+				result.insert(key);
+			}
+			else if (_prefetched.erase(key) != 0)
 			{
-				result.insert(new_pos);
+				// it got here ahead of the camera
+				_stats._prefetch_hits++;
 			}
 		}
 	}
 
+	// and the chunks along the way the camera is heading
+	build_prefetch_cone(chunk_x, chunk_z);
+	for (auto& key : _prefetch_cone)
+	{
+		if (_pieces->find(key.first, key.second) == NULL)
+		{
+			result.insert(key);
+		}
+	}
+
 	// remove chunks too far away
-	auto itr = _pieces.begin();
-	while (itr != _pieces.end())
+	for (int i = 0; i < _pieces->get_slot_count(); i++)
 	{
-		int x = itr->first.first - chunk_x;
-		int y = itr->first.second - chunk_z;
-		if (x * x + y * y > _radius * _radius)
+		ga_terrain_chunk_slot slot = _pieces->get_slot(i);
+		if (slot._chunk == NULL)
 		{
+			continue;
+		}
+
+		int x = slot._x - chunk_x;
+		int y = slot._z - chunk_z;
+		std::pair<int, int> key = std::make_pair(slot._x, slot._z);
+		if (x * x + y * y > _radius * _radius && _prefetch_cone.count(key) == 0)
+		{
+			if (_prefetched.erase(key) != 0)
+			{
+				_stats._prefetch_wasted++;
+			}
+
 			// delete the pieces of terrain that are too far away
-			if (result.find(itr->first) != result.end())
+			result.erase(key);
+			// its GPU mesh was drawn this frame, but is only written again
+			// by an upload after drawing
+			_pieces->remove(slot._x, slot._z);
+			_leaving.push_back(slot._chunk);
+		}
+	}
+
+	cache_chunks();
+	return result;
+}
+
+void ga_terrain_component::cache_chunks()
+{
+	if (_chunk_cache != NULL)
+	{
+		struct compress_data_t
+		{
+			const ga_terrain_chunk* _chunk;
+			std::vector<uint8_t>* _data;
+			int _bits;
+		};
+
+		// previews are cheap to generate again, so only refined chunks are kept
+		const int k_max_jobs = 64;
+		ga_job_decl_t decls[k_max_jobs];
+		compress_data_t data[k_max_jobs];
+		int job_count = 0;
+		for (size_t i = 0; i < _leaving.size(); i++)
+		{
+			ga_terrain_chunk* chunk = _leaving[i];
+			if (chunk->is_refined())
+			{
+				data[job_count]._chunk = chunk;
+				data[job_count]._data = &_chunk_cache->insert(chunk->get_x(), chunk->get_z());
+				data[job_count]._bits = _chunk_cache->get_bits();
+
+				decls[job_count]._data = &data[job_count];
+				decls[job_count]._entry = [](void* data)
+				{
+					auto compress = static_cast<compress_data_t*>(data);
+					compress->_chunk->compress(compress->_bits, *compress->_data);
+				};
+				job_count++;
+			}
+
+			if (job_count == k_max_jobs || (job_count > 0 && i + 1 == _leaving.size()))
 			{
-				result.erase(itr->first);
+				int32_t counter;
+				ga_job::run(decls, job_count, &counter);
+				ga_job::wait(&counter);
+				job_count = 0;
 			}
-			get_entity()->dynamic_remove_component(itr->second);
-			itr = _pieces.erase(itr);
 		}
-		else
+		_chunk_cache->trim();
+
+		_stats._cached = _chunk_cache->get_count();
+		_stats._cached_bytes = _chunk_cache->get_bytes();
+	}
+
+	// an edit this frame may have queued the chunk for upload; the pool can
+	// hand it straight to a worker, which mustn't rebuild it under the GL thread
+	for (ga_terrain_chunk* chunk : _leaving)
+	{
+		_pipeline->cancel_reupload(chunk);
+		_chunk_pool->free(chunk);
+	}
+	_leaving.clear();
+}
+
+void ga_terrain_component::update_velocity(ga_frame_params* params, ga_vec3f eye_position)
+{
+	float dt = std::chrono::duration_cast<std::chrono::duration<float>>(params->_delta_time).count();
+	if (_has_last_eye_position && dt > 0.0f)
+	{
+		ga_vec2f instant = {
+			(eye_position.x - _last_eye_position.x) / dt,
+			(eye_position.z - _last_eye_position.z) / dt
+		};
+
+		// smooth out frame to frame jitter in the camera's motion
+		const float k_smoothing = 0.2f;
+		_velocity.x += (instant.x - _velocity.x) * k_smoothing;
+		_velocity.y += (instant.y - _velocity.y) * k_smoothing;
+	}
+
+	_last_eye_position = eye_position;
+	_has_last_eye_position = true;
+}
+
+void ga_terrain_component::build_prefetch_cone(int chunk_x, int chunk_z)
+{
+	_prefetch_cone.clear();
+
+	// how far past the radius the camera will travel in the lookahead time
+	float speed = std::sqrt(_velocity.x * _velocity.x + _velocity.y * _velocity.y);
+	float lookahead = speed * _field->get_params()._prefetch_time / _width;
+	lookahead = std::fmin(lookahead, (float) _prefetch_distance);
+	if (lookahead < 0.5f)
+	{
+		return;
+	}
+
+	// take chunks past the radius within 30 degrees of the direction of travel
+	const float k_cos_half_angle = 0.866f;
+	float dir_x = _velocity.x / speed;
+	float dir_z = _velocity.y / speed;
+	float reach = _radius + lookahead;
+	int extent = (int) std::ceil(reach);
+
+	for (int i = -extent; i <= extent; i++)
+	{
+		for (int j = -extent; j <= extent; j++)
 		{
-			itr++;
+			float distance = std::sqrt((float) (i * i + j * j));
+			if (i * i + j * j < _radius * _radius || distance > reach)
+			{
+				continue;
+			}
+
+			if ((i * dir_x + j * dir_z) >= k_cos_half_angle * distance)
+			{
+				_prefetch_cone.insert(std::make_pair(chunk_x + i, chunk_z + j));
+			}
 		}
 	}
+}
 
-	return result;
+static std::string _get_edit_path(const std::string& edit_file)
+{
+	// relative to the root, like the param file
+	extern char g_root_path[256];
+	return std::string(g_root_path) + edit_file;
 }
 
-// initialize the static material to null
-ga_wireframe_material* ga_terrain_component::_material = NULL;
-std::map<std::pair<int, int>, ga_terrain_component*> ga_terrain_component::_pieces;
\ No newline at end of file
+static void _update_cost(float* cost, float milliseconds)
+{
+	// the first chunk sets the average, later ones ease it along
+	*cost = (*cost == 0.0f) ? milliseconds : *cost + (milliseconds - *cost) * k_cost_smoothing;
+}
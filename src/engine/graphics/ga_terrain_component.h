@@ -1,63 +1,197 @@
+#pragma once
+
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Terrain generator component
+*/
 
 #include "entity/ga_component.h"
 #include "framework/ga_camera.h"
-
+#include "jobs/ga_job.h"
+#include "math/ga_vec2f.h"
+#include "terrain/ga_terrain_culler.h"
+#include "terrain/ga_terrain_edit_layer.h"
+#include "terrain/ga_terrain_flow.h"
+#include "terrain/ga_terrain_horizon.h"
+#include "terrain/ga_terrain_scheduler.h"
+#include "terrain/ga_terrain_stats.h"
+
+#include <chrono>
 #include <set>
-#include <map>
+#include <vector>
 
+/*
+** Result of a ray cast against the loaded terrain.
+*/
+struct ga_terrain_ray_hit
+{
+	bool _hit;
+	float _t;
+	ga_vec3f _position;
+};
+
+/*
+** Streams chunks of procedural terrain in and out around the camera and
+** draws the ones in view. Setting clipmap_levels in the param file draws a
+** geometry clipmap around the camera instead.
+*/
 class ga_terrain_component : public ga_component
 {
 public:
-	ga_terrain_component(class ga_entity* ent, const char* param_file, class ga_camera* cam, bool dynamic = false);
+	ga_terrain_component(class ga_entity* ent, const char* param_file, class ga_camera* cam);
 	virtual ~ga_terrain_component();
 
-	void init();
-
 	virtual void update(struct ga_frame_params* params) override;
 	virtual void late_update(struct ga_frame_params* params) override;
 
+	// the procedural field the chunks are generated from, for height queries
+	const class ga_terrain_field* get_field() const { return _field; }
+
+	/*
+	** Get the height of the rendered terrain at world (x, z), bilinearly
+	** sampled from the chunk loaded there, or from the field if none is.
+	** Safe to call from update, but not concurrently with late_update.
+	*/
+	float get_height(float x, float z) const;
+
+	/*
+	** Batched version of get_height for count (x, z) positions.
+	*/
+	void get_heights(const float* x, const float* z, float* heights, int count) const;
+
+	/*
+	** Cast a ray against the loaded chunks, walking each chunk's min/max
+	** pyramid. Chunks that aren't resident are treated as empty space.
+	*/
+	bool raycast(const ga_vec3f& origin, const ga_vec3f& dir, float max_distance, ga_terrain_ray_hit* hit) const;
+
+	/*
+	** Cast count rays in parallel on the job system.
+	*/
+	void raycast(const ga_vec3f* origins, const ga_vec3f* dirs, float max_distance, ga_terrain_ray_hit* hits, int count) const;
+
+	/*
+	** Apply a brush stroke to the terrain. Loaded chunks it reaches are
+	** re-meshed right away and the rest pick it up when streamed in. Not
+	** supported in clipmap mode. Safe to call from update, but not
+	** concurrently with late_update. Holding R, F, G or T raises, lowers,
+	** smooths or flattens the terrain the camera looks at, and setting
+	** edit_file in the param file keeps edits between sessions.
+	*/
+	void edit(const ga_terrain_brush& brush);
+
+	/*
+	** Route water over the loaded chunks, one job per chunk, and return the
+	** flow directions and accumulation for finding rivers and lakes. Valid
+	** until the next call. Safe to call from update, but not concurrently
+	** with late_update.
+	*/
+	const ga_terrain_flow& compute_flow();
+
+	const ga_terrain_stats& get_stats() const { return _stats; }
+
 private:
-	static class ga_wireframe_material* _material;
+	class ga_wireframe_material* _material;
+
+	// procedural height source shared by every chunk
+	class ga_terrain_field* _field;
+
+	// loaded chunks, keyed by chunk coordinates
+	class ga_terrain_chunk_grid* _pieces;
+
+	// evicted chunks and finished tasks kept for reuse
+	class ga_terrain_chunk_pool* _chunk_pool;
+	std::vector<class ga_terrain_task*> _free_tasks;
+
+	// compressed heightmaps of chunks that left the radius, if enabled;
+	// chunks leaving this frame wait in _leaving to be compressed together
+	class ga_terrain_chunk_cache* _chunk_cache;
+	std::vector<class ga_terrain_chunk*> _leaving;
+	void cache_chunks();
 
-	static std::map<std::pair<int, int>, ga_terrain_component*> _pieces;
+	// offsets brushes have made to the field, and loaded chunks waiting to
+	// be built again with them
+	ga_terrain_edit_layer* _edit_layer;
+	std::set<std::pair<int, int> > _touched;
+	std::vector<class ga_terrain_chunk*> _remesh;
+	void remesh_chunks();
 
-	// data and helper for actually drawing the terrain
-	void setup_vertices();
-	std::vector<ga_vec3f> _vertices;
-	std::vector<uint16_t> _indices;
+	// the brush held down last frame, or -1, and the height flatten holds to
+	int _brush_op;
+	float _brush_height;
+	void apply_brush_keys(struct ga_frame_params* params);
+
+	// water routed over the loaded chunks by compute_flow()
+	ga_terrain_flow* _flow;
+	std::vector<class ga_terrain_chunk*> _flow_chunks;
+	void run_flow_stage(int tile_count, ga_job_function_t entry);
+
+	// rings drawn instead of chunks in clipmap mode, otherwise null
+	class ga_terrain_clipmap* _clipmap;
+
+	// find the loaded chunk covering world (x, z), if any
+	class ga_terrain_chunk* find_chunk(float x, float z) const;
 
 	// a reference to the player object so we can dynamically generate terrain
 	ga_camera* _camera;
 
-	// Terrain representation
+	// Terrain parameters
 	int _size;
 	float _width;
-	int _height;
 	int _radius;
-	float* _points;
-	ga_vec2f _position;
-	const char* _param_file;
-
-	// storage for surrounding terrain tiles
-	ga_terrain_component* _parent;
-
+	int _prefetch_distance;
+
+	// chunks tested against the view this frame, parallel to the culler's boxes
+	std::vector<class ga_terrain_chunk*> _cull_chunks;
+	ga_terrain_culler _culler;
+
+	// frustum survivors sorted front to back for the occlusion pass
+	std::vector<std::pair<float, class ga_terrain_chunk*> > _draw_order;
+
+	// chunks waiting to be generated, serviced under the frame budget
+	ga_terrain_scheduler _scheduler;
+
+	// running averages of the worker milliseconds a generated and a restored
+	// chunk take, charged against the frame budget as each one is submitted
+	float _generate_cost_ms;
+	float _restore_cost_ms;
+
+	// chunks on their way through noise, mesh and upload
+	class ga_terrain_pipeline* _pipeline;
+	std::vector<class ga_terrain_task*> _tasks;
+	void collect_tasks(std::set<std::pair<int, int> >& wanted);
+	float get_priority(int x, int z, const ga_vec3f& eye_position) const;
+
+	// previews still waiting for detail, nearest first
+	std::vector<std::pair<float, class ga_terrain_chunk*> > _refine_order;
+	ga_terrain_horizon _horizon;
+
+	void draw_chunks(struct ga_frame_params* params);
+	void draw_chunk(struct ga_frame_params* params, const class ga_terrain_chunk* chunk);
+	void draw_clipmap(struct ga_frame_params* params);
+
+	ga_terrain_stats _stats;
+	int _last_sampled;
+	int _last_meshed;
+	int _last_uploaded;
+	int _last_stalled;
+	std::chrono::high_resolution_clock::time_point _last_stats_time;
+	void print_stats(struct ga_frame_params* params);
+
+	void stream_chunks(struct ga_frame_params* params, ga_vec3f eye_position);
+	void refine_chunks(ga_vec3f eye_position);
 	std::set<std::pair<int, int> > build_neighbors(ga_vec3f eye_position);
 
-	// some helper getters/setters
-	float get_point(int x, int y);
-	void set_point(int x, int y, float height);
-	ga_vec2f point_to_position(int x, int y);
-
-	// and methods to generate terrain / vbo objects
-	void generate_terrain();
-
-	// helper functions for Perlin noise implementation
-	static float noise(float x, float y, float z);
-	static float fade(float t) { return t * t * t * (t * (t * 6 - 15) + 10); }
-	static float lerp(float t, float a, float b) { return a + t * (b - a); }
-	static float grad(int hash, float x, float y, float z);
-
-	// permutation vector getters for Perlin noise
-	static const int get_p(int i);
-	static const int get_permutation (int i);
-};
\ No newline at end of file
+	// smoothed horizontal camera velocity, in world units per second
+	void update_velocity(struct ga_frame_params* params, ga_vec3f eye_position);
+	ga_vec3f _last_eye_position;
+	bool _has_last_eye_position;
+	ga_vec2f _velocity;
+
+	// chunks ahead of the camera this frame, and prefetched ones not yet in range
+	void build_prefetch_cone(int chunk_x, int chunk_z);
+	std::set<std::pair<int, int> > _prefetch_cone;
+	std::set<std::pair<int, int> > _prefetched;
+};
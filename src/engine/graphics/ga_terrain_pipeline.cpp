@@ -0,0 +1,366 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Staged streaming pipeline for terrain chunks
+*/
+#include "ga_terrain_pipeline.h"
+
+#include "framework/ga_frame_params.h"
+#include "terrain/ga_terrain_chunk.h"
+#include "terrain/ga_terrain_task.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+// the streamer keeps at most this many tasks in flight, so done never fills
+static const int k_noise_capacity = 32;
+static const int k_mesh_capacity = 8;
+static const int k_upload_capacity = 8;
+static const int k_done_capacity = 32;
+
+static void _push(ga_terrain_stage_queue& queue, ga_terrain_task* task);
+
+ga_terrain_pipeline::ga_terrain_pipeline() :
+	_noise_queue(k_noise_capacity),
+	_mesh_queue(k_mesh_capacity),
+	_upload_queue(k_upload_capacity),
+	_done_queue(k_done_capacity)
+{
+	for (int i = 0; i < k_max_workers; i++)
+	{
+		_workers[i]._pipeline = this;
+		_workers[i]._decl._entry = run_worker;
+		_workers[i]._decl._data = &_workers[i];
+		_workers[i]._counter = 0;
+	}
+
+	_sampled = 0;
+	_meshed = 0;
+	_uploaded = 0;
+	_stalled = 0;
+	_upload_budget_ms = 0.0f;
+}
+
+ga_terrain_pipeline::~ga_terrain_pipeline()
+{
+	shutdown();
+}
+
+bool ga_terrain_pipeline::can_submit() const
+{
+	return _noise_queue.get_count() < _noise_queue.get_capacity();
+}
+
+void ga_terrain_pipeline::submit(ga_terrain_task* task)
+{
+	_push(_noise_queue, task);
+}
+
+void ga_terrain_pipeline::kick()
+{
+	if (_noise_queue.get_count() == 0 && _mesh_queue.get_count() == 0)
+	{
+		return;
+	}
+
+	// one job per idle worker; each runs until it runs out of work it can do
+	for (int i = 0; i < k_max_workers; i++)
+	{
+		if (_workers[i]._counter == 0)
+		{
+			ga_job::run(&_workers[i]._decl, 1, &_workers[i]._counter);
+		}
+	}
+}
+
+void ga_terrain_pipeline::run_worker(void* data)
+{
+	ga_terrain_pipeline* pipeline = static_cast<worker_t*>(data)->_pipeline;
+
+	// drain toward the GPU first, so finished samples don't wait on new ones
+	for (;;)
+	{
+		if (!pipeline->step_mesh() && !pipeline->step_noise())
+		{
+			break;
+		}
+	}
+}
+
+bool ga_terrain_pipeline::step_mesh()
+{
+	if (!_upload_queue.reserve())
+	{
+		if (_mesh_queue.get_count() > 0)
+		{
+			_stalled++;
+		}
+		return false;
+	}
+
+	ga_terrain_task* task;
+	if (!_mesh_queue.pop((void**) &task))
+	{
+		_upload_queue.unreserve();
+		return false;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	task->run_mesh();
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	task->add_work_ms(elapsed.count());
+	if (task->is_cancelled())
+	{
+		// nothing left worth uploading
+		_upload_queue.unreserve();
+		_push(_done_queue, task);
+		return true;
+	}
+
+	_meshed++;
+	_upload_queue.push_reserved(task);
+	return true;
+}
+
+bool ga_terrain_pipeline::step_noise()
+{
+	if (!_mesh_queue.reserve())
+	{
+		if (_noise_queue.get_count() > 0)
+		{
+			_stalled++;
+		}
+		return false;
+	}
+
+	ga_terrain_task* task;
+	if (!_noise_queue.pop((void**) &task))
+	{
+		_mesh_queue.unreserve();
+		return false;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	task->run_noise();
+	if (!task->is_cancelled())
+	{
+		erode(task->get_chunk());
+	}
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+	task->add_work_ms(elapsed.count());
+	if (task->is_cancelled())
+	{
+		_mesh_queue.unreserve();
+		_push(_done_queue, task);
+		return true;
+	}
+
+	_sampled++;
+	_mesh_queue.push_reserved(task);
+	return true;
+}
+
+void ga_terrain_pipeline::queue_gl_work(ga_frame_params* params)
+{
+	ga_gl_work work;
+	work._entry = run_gl_stage;
+	work._data = this;
+
+	while (params->_gl_work_lock.test_and_set(std::memory_order_acquire)) {}
+	params->_gl_work.push_back(work);
+	params->_gl_work_lock.clear(std::memory_order_release);
+}
+
+void ga_terrain_pipeline::run_gl_stage(void* data)
+{
+	ga_terrain_pipeline* pipeline = static_cast<ga_terrain_pipeline*>(data);
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// edits show up the frame they're made, whatever the budget
+	for (ga_terrain_chunk* chunk : pipeline->_reuploads)
+	{
+		upload(chunk);
+	}
+	pipeline->_reuploads.clear();
+
+	// then new chunks until the budget runs out, so a burst of them doesn't
+	// stall a single frame; at least one goes up so the queue keeps moving
+	ga_terrain_task* task;
+	while (pipeline->_upload_queue.pop((void**) &task))
+	{
+		if (!task->is_cancelled())
+		{
+			upload(task->get_chunk());
+			pipeline->_uploaded++;
+		}
+
+		_push(pipeline->_done_queue, task);
+
+		std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		if (pipeline->_upload_budget_ms > 0.0f && elapsed.count() >= pipeline->_upload_budget_ms)
+		{
+			break;
+		}
+	}
+
+	// uploading made room downstream, so restart anything that stalled
+	pipeline->kick();
+}
+
+void ga_terrain_pipeline::upload(ga_terrain_chunk* chunk)
+{
+	// pooled chunks keep their GPU mesh, so most uploads reuse one
+	ga_terrain_gpu_mesh* mesh = chunk->get_gpu_mesh();
+	if (mesh == 0)
+	{
+		mesh = new ga_terrain_gpu_mesh();
+		glGenVertexArrays(1, &mesh->_vao);
+		glGenBuffers(1, &mesh->_positions);
+		glGenBuffers(1, &mesh->_indices);
+		mesh->_position_bytes = 0;
+		mesh->_index_bytes = 0;
+		chunk->set_gpu_mesh(mesh);
+	}
+
+	glBindVertexArray(mesh->_vao);
+
+	const std::vector<ga_vec3f>& vertices = chunk->get_vertices();
+	upload_buffer(GL_ARRAY_BUFFER, mesh->_positions, &mesh->_position_bytes,
+		sizeof(ga_vec3f) * vertices.size(), &vertices[0]);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+	glEnableVertexAttribArray(0);
+
+	if (chunk->has_wide_indices())
+	{
+		const std::vector<uint32_t>& indices = chunk->get_wide_indices();
+		upload_buffer(GL_ELEMENT_ARRAY_BUFFER, mesh->_indices, &mesh->_index_bytes,
+			sizeof(uint32_t) * indices.size(), &indices[0]);
+		mesh->_index_count = (GLsizei) indices.size();
+		mesh->_index_type = GL_UNSIGNED_INT;
+	}
+	else
+	{
+		const std::vector<uint16_t>& indices = chunk->get_indices();
+		upload_buffer(GL_ELEMENT_ARRAY_BUFFER, mesh->_indices, &mesh->_index_bytes,
+			sizeof(uint16_t) * indices.size(), &indices[0]);
+		mesh->_index_count = (GLsizei) indices.size();
+		mesh->_index_type = GL_UNSIGNED_SHORT;
+	}
+	mesh->_draw_mode = chunk->is_strip() ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+
+	glBindVertexArray(0);
+}
+
+void ga_terrain_pipeline::upload_buffer(GLenum target, GLuint buffer, GLsizeiptr* size, GLsizeiptr bytes, const void* data)
+{
+	glBindBuffer(target, buffer);
+	if (*size == bytes)
+	{
+		glBufferSubData(target, 0, bytes, data);
+	}
+	else
+	{
+		glBufferData(target, bytes, data, GL_STATIC_DRAW);
+		*size = bytes;
+	}
+}
+
+void ga_terrain_pipeline::free_gpu_mesh(ga_terrain_gpu_mesh* mesh)
+{
+	if (mesh == 0)
+	{
+		return;
+	}
+
+	glDeleteBuffers(1, &mesh->_positions);
+	glDeleteBuffers(1, &mesh->_indices);
+	glDeleteVertexArrays(1, &mesh->_vao);
+	delete mesh;
+}
+
+bool ga_terrain_pipeline::pop_done(ga_terrain_task** task)
+{
+	return _done_queue.pop((void**) task);
+}
+
+void ga_terrain_pipeline::reupload(ga_terrain_chunk* chunk)
+{
+	if (chunk->get_gpu_mesh() != 0)
+	{
+		_reuploads.push_back(chunk);
+	}
+}
+
+void ga_terrain_pipeline::cancel_reupload(ga_terrain_chunk* chunk)
+{
+	_reuploads.erase(std::remove(_reuploads.begin(), _reuploads.end(), chunk), _reuploads.end());
+}
+
+void ga_terrain_pipeline::erode(ga_terrain_chunk* chunk)
+{
+	const std::vector<ga_terrain_erosion_tile>& tiles = chunk->build_erosion_tiles();
+
+	// tiles are sorted by pass; a pass's tiles never touch the same samples
+	const int k_max_jobs = 64;
+	ga_job_decl_t decls[k_max_jobs];
+	size_t first = 0;
+	while (first < tiles.size())
+	{
+		int job_count = 0;
+		while (job_count < k_max_jobs && first + job_count < tiles.size() &&
+			tiles[first + job_count]._pass == tiles[first]._pass)
+		{
+			decls[job_count]._data = (void*) &tiles[first + job_count];
+			decls[job_count]._entry = [](void* data)
+			{
+				ga_terrain_erosion::erode_tile(*static_cast<const ga_terrain_erosion_tile*>(data));
+			};
+			job_count++;
+		}
+
+		int32_t counter;
+		ga_job::run(decls, job_count, &counter);
+		ga_job::wait(&counter);
+		first += job_count;
+	}
+
+	// cheap enough to run over the whole chunk on the job it was called from
+	chunk->finish_erosion();
+}
+
+void ga_terrain_pipeline::shutdown()
+{
+	// workers skip cancelled items straight to done, so they finish quickly
+	ga_terrain_task* task;
+	while (_noise_queue.pop((void**) &task))
+	{
+		task->cancel();
+		_push(_done_queue, task);
+	}
+
+	for (int i = 0; i < k_max_workers; i++)
+	{
+		ga_job::wait(&_workers[i]._counter);
+	}
+
+	while (_mesh_queue.pop((void**) &task))
+	{
+		_push(_done_queue, task);
+	}
+	while (_upload_queue.pop((void**) &task))
+	{
+		_push(_done_queue, task);
+	}
+
+	_reuploads.clear();
+}
+
+static void _push(ga_terrain_stage_queue& queue, ga_terrain_task* task)
+{
+	// queues are sized so this can't fail
+	bool pushed = queue.try_push(task);
+	assert(pushed);
+	(void) pushed;
+}
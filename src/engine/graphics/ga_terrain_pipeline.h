@@ -0,0 +1,121 @@
+#pragma once
+
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Staged streaming pipeline for terrain chunks
+*/
+
+#include "jobs/ga_job.h"
+#include "terrain/ga_terrain_stage_queue.h"
+
+#include <atomic>
+#include <vector>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+/*
+** A chunk's mesh once it has been uploaded to the GPU.
+*/
+struct ga_terrain_gpu_mesh
+{
+	GLuint _vao;
+	GLuint _positions;
+	GLuint _indices;
+	GLsizei _index_count;
+	GLenum _index_type;
+	GLenum _draw_mode;
+
+	// buffer sizes, so an upload of the same size can reuse the storage
+	GLsizeiptr _position_bytes;
+	GLsizeiptr _index_bytes;
+};
+
+/*
+** Moves chunks through noise -> mesh -> upload.
+** Noise and mesh run on a few long-lived jobs that pull from bounded queues;
+** upload runs on the GL thread at the end of the output stage. A stage only
+** takes an item once it holds a slot in the next stage's queue, so a slow
+** upload stalls meshing and noise rather than letting finished chunks pile
+** up. Finished and cancelled tasks come back out through pop_done().
+*/
+class ga_terrain_pipeline
+{
+public:
+	ga_terrain_pipeline();
+	~ga_terrain_pipeline();
+
+	// whether the noise queue has room for another task
+	bool can_submit() const;
+	void submit(class ga_terrain_task* task);
+
+	// start workers for whatever is queued
+	void kick();
+
+	// queue this frame's uploads to run on the GL thread, which stop once
+	// they've taken the upload budget; 0 ms or less uploads all that's ready
+	void set_upload_budget(float milliseconds) { _upload_budget_ms = milliseconds; }
+	void queue_gl_work(struct ga_frame_params* params);
+
+	// take a task that has been uploaded, or skipped the rest after cancelling
+	bool pop_done(class ga_terrain_task** task);
+
+	// upload a chunk again after its mesh has changed, or drop it from the
+	// uploads waiting on the GL thread before it goes back to the pool
+	void reupload(class ga_terrain_chunk* chunk);
+	void cancel_reupload(class ga_terrain_chunk* chunk);
+
+	/*
+	** Run the chunk's erosion tiles, if any, as jobs in checkerboard passes
+	** and wait for them, then its thermal erosion. May be called from a job.
+	*/
+	static void erode(class ga_terrain_chunk* chunk);
+
+	/*
+	** Cancel everything in flight and wait for the workers.
+	*/
+	void shutdown();
+
+	// running totals of items through each stage, and of times a stage
+	// found its output queue full
+	int get_sampled() const { return _sampled; }
+	int get_meshed() const { return _meshed; }
+	int get_uploaded() const { return _uploaded; }
+	int get_stalled() const { return _stalled; }
+
+	static void free_gpu_mesh(struct ga_terrain_gpu_mesh* mesh);
+
+private:
+	ga_terrain_stage_queue _noise_queue;
+	ga_terrain_stage_queue _mesh_queue;
+	ga_terrain_stage_queue _upload_queue;
+	ga_terrain_stage_queue _done_queue;
+
+	static const int k_max_workers = 4;
+	struct worker_t
+	{
+		ga_terrain_pipeline* _pipeline;
+		ga_job_decl_t _decl;
+		int32_t _counter;
+	};
+	worker_t _workers[k_max_workers];
+
+	static void run_worker(void* data);
+	bool step_mesh();
+	bool step_noise();
+
+	static void run_gl_stage(void* data);
+	static void upload(class ga_terrain_chunk* chunk);
+	static void upload_buffer(GLenum target, GLuint buffer, GLsizeiptr* size, GLsizeiptr bytes, const void* data);
+
+	// chunks waiting on the GL thread, touched only by the main thread
+	std::vector<class ga_terrain_chunk*> _reuploads;
+	float _upload_budget_ms;
+
+	std::atomic_int _sampled;
+	std::atomic_int _meshed;
+	std::atomic_int _uploaded;
+	std::atomic_int _stalled;
+};
@@ -9,6 +9,7 @@
 
 #include "framework/ga_camera.h"
 #include "framework/ga_compiler_defines.h"
+#include "framework/ga_cpu.h"
 #include "framework/ga_input.h"
 #include "framework/ga_sim.h"
 #include "framework/ga_output.h"
@@ -36,6 +37,7 @@ int main(int argc, const char** argv)
 {
 	set_root_path(argv[0]);
 
+	ga_cpu::startup();
 	ga_job::startup(0xffff, 256, 256);
 
 	// Create objects for three phases of the frame: input, sim and output.
@@ -0,0 +1,75 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "math/ga_aabb.h"
+
+#include "math/ga_mat4f.h"
+#include "math/ga_math.h"
+
+ga_vec3f ga_aabb::get_center() const
+{
+	return { (min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f };
+}
+
+ga_vec3f ga_aabb::get_extent() const
+{
+	return { (max.x - min.x) * 0.5f, (max.y - min.y) * 0.5f, (max.z - min.z) * 0.5f };
+}
+
+bool ga_aabb::contains(const ga_vec3f& __restrict point) const
+{
+	return point.x >= min.x && point.x <= max.x &&
+		point.y >= min.y && point.y <= max.y &&
+		point.z >= min.z && point.z <= max.z;
+}
+
+bool ga_aabb::overlaps(const ga_aabb& __restrict b) const
+{
+	return min.x <= b.max.x && max.x >= b.min.x &&
+		min.y <= b.max.y && max.y >= b.min.y &&
+		min.z <= b.max.z && max.z >= b.min.z;
+}
+
+void ga_aabb::expand(const ga_vec3f& __restrict point)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		min.axes[i] = ga_min(min.axes[i], point.axes[i]);
+		max.axes[i] = ga_max(max.axes[i], point.axes[i]);
+	}
+}
+
+ga_aabb ga_aabb::transform(const ga_mat4f& __restrict m) const
+{
+	ga_aabb result;
+	m.transform_aabbs(&min, &max, &result.min, &result.max, 1);
+	return result;
+}
+
+void ga_aabb_soa::clear()
+{
+	center_x.clear();
+	center_y.clear();
+	center_z.clear();
+	extent_x.clear();
+	extent_y.clear();
+	extent_z.clear();
+}
+
+void ga_aabb_soa::push_back(const ga_aabb& __restrict box)
+{
+	ga_vec3f center = box.get_center();
+	ga_vec3f extent = box.get_extent();
+	center_x.push_back(center.x);
+	center_y.push_back(center.y);
+	center_z.push_back(center.z);
+	extent_x.push_back(extent.x);
+	extent_y.push_back(extent.y);
+	extent_z.push_back(extent.z);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "math/ga_vec3f.h"
+
+#include <vector>
+
+/*
+** Axis-aligned bounding box.
+*/
+struct ga_aabb
+{
+	ga_vec3f min;
+	ga_vec3f max;
+
+	/*
+	** Get the center of the box.
+	*/
+	ga_vec3f get_center() const;
+
+	/*
+	** Get half the size of the box along each axis.
+	*/
+	ga_vec3f get_extent() const;
+
+	/*
+	** Determine if a point is in the box, boundary included.
+	*/
+	bool contains(const ga_vec3f& __restrict point) const;
+
+	/*
+	** Determine if two boxes share any point.
+	*/
+	bool overlaps(const ga_aabb& __restrict b) const;
+
+	/*
+	** Grow the box to hold a point.
+	*/
+	void expand(const ga_vec3f& __restrict point);
+
+	/*
+	** Transform the box by an affine matrix, giving the smallest box that
+	** holds the result.
+	*/
+	ga_aabb transform(const struct ga_mat4f& __restrict m) const;
+};
+
+/*
+** Boxes stored as separate center and extent arrays, so batch tests can
+** load the same component of several boxes at once.
+*/
+struct ga_aabb_soa
+{
+	std::vector<float> center_x;
+	std::vector<float> center_y;
+	std::vector<float> center_z;
+	std::vector<float> extent_x;
+	std::vector<float> extent_y;
+	std::vector<float> extent_z;
+
+	/*
+	** Remove every box, keeping the storage.
+	*/
+	void clear();
+
+	void push_back(const ga_aabb& __restrict box);
+
+	int size() const { return (int) center_x.size(); }
+};
@@ -0,0 +1,372 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "math/ga_frustum.h"
+
+#include "math/ga_mat4f.h"
+#include "math/ga_math.h"
+
+#include "framework/ga_compiler_defines.h"
+#include "framework/ga_cpu.h"
+
+#include <cstring>
+
+#if defined(GA_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(GA_AVX2)
+#include <immintrin.h>
+#endif
+
+// batch kernels classify a multiple of their width from the start and
+// return how many they did
+typedef int (*test_boxes_t)(const ga_frustum& f, const ga_aabb_soa& boxes, uint8_t* results);
+typedef int (*test_spheres_t)(const ga_frustum& f, const ga_sphere_soa& spheres, uint8_t* results);
+
+struct test_kernels_t
+{
+	test_boxes_t _boxes;
+	test_spheres_t _spheres;
+};
+
+static const test_kernels_t& _get_kernels();
+static test_kernels_t _bind_kernels();
+static ga_frustum_test _test_box(const ga_frustum& f, float cx, float cy, float cz, float ex, float ey, float ez);
+static ga_frustum_test _test_sphere(const ga_frustum& f, float cx, float cy, float cz, float r);
+static int _test_boxes_scalar(const ga_frustum& f, const ga_aabb_soa& boxes, uint8_t* results);
+static int _test_spheres_scalar(const ga_frustum& f, const ga_sphere_soa& spheres, uint8_t* results);
+#if defined(GA_SSE2)
+static int _test_boxes_sse2(const ga_frustum& f, const ga_aabb_soa& boxes, uint8_t* results);
+static int _test_spheres_sse2(const ga_frustum& f, const ga_sphere_soa& spheres, uint8_t* results);
+static __m128i _classify4(__m128 outside, __m128 inside);
+#endif
+#if defined(GA_AVX2)
+GA_TARGET_AVX2 static int _test_boxes_avx2(const ga_frustum& f, const ga_aabb_soa& boxes, uint8_t* results);
+GA_TARGET_AVX2 static int _test_spheres_avx2(const ga_frustum& f, const ga_sphere_soa& spheres, uint8_t* results);
+GA_TARGET_AVX2 static void _store_classes8(uint8_t* results, __m256 outside, __m256 inside);
+#endif
+
+void ga_frustum::make_from_view_projection(const ga_mat4f& __restrict view_proj)
+{
+	// points transform as rows, so clip = p * M and each clip component is a
+	// column of M; the planes are sums and differences of those columns
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int row = 0; row < 4; ++row)
+		{
+			planes[2 * i].axes[row] = view_proj.data[row][3] + view_proj.data[row][i];
+			planes[2 * i + 1].axes[row] = view_proj.data[row][3] - view_proj.data[row][i];
+		}
+	}
+
+	for (int p = 0; p < 6; ++p)
+	{
+		float length = ga_sqrtf(planes[p].x * planes[p].x + planes[p].y * planes[p].y + planes[p].z * planes[p].z);
+		if (length > 0.0f)
+		{
+			for (int i = 0; i < 4; ++i)
+			{
+				planes[p].axes[i] /= length;
+			}
+		}
+	}
+}
+
+ga_frustum_test ga_frustum::test_box(const ga_aabb& __restrict box) const
+{
+	ga_vec3f center = box.get_center();
+	ga_vec3f extent = box.get_extent();
+	return _test_box(*this, center.x, center.y, center.z, extent.x, extent.y, extent.z);
+}
+
+ga_frustum_test ga_frustum::test_sphere(const ga_sphere& __restrict sphere) const
+{
+	return _test_sphere(*this, sphere.center.x, sphere.center.y, sphere.center.z, sphere.radius);
+}
+
+int ga_frustum::test_boxes(const ga_aabb_soa& __restrict boxes, uint8_t* __restrict results) const
+{
+	int count = boxes.size();
+	for (int i = _get_kernels()._boxes(*this, boxes, results); i < count; ++i)
+	{
+		results[i] = (uint8_t) _test_box(*this, boxes.center_x[i], boxes.center_y[i], boxes.center_z[i],
+			boxes.extent_x[i], boxes.extent_y[i], boxes.extent_z[i]);
+	}
+
+	int visible = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		visible += results[i] != k_frustum_outside;
+	}
+	return visible;
+}
+
+int ga_frustum::test_spheres(const ga_sphere_soa& __restrict spheres, uint8_t* __restrict results) const
+{
+	int count = spheres.size();
+	for (int i = _get_kernels()._spheres(*this, spheres, results); i < count; ++i)
+	{
+		results[i] = (uint8_t) _test_sphere(*this, spheres.center_x[i], spheres.center_y[i], spheres.center_z[i],
+			spheres.radius[i]);
+	}
+
+	int visible = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		visible += results[i] != k_frustum_outside;
+	}
+	return visible;
+}
+
+static const test_kernels_t& _get_kernels()
+{
+	static const test_kernels_t kernels = _bind_kernels();
+	return kernels;
+}
+
+static test_kernels_t _bind_kernels()
+{
+	test_kernels_t bound = { _test_boxes_scalar, _test_spheres_scalar };
+#if defined(GA_SSE2)
+	if (ga_cpu::get_tier() >= k_cpu_tier_sse2)
+	{
+		bound = { _test_boxes_sse2, _test_spheres_sse2 };
+	}
+#endif
+#if defined(GA_AVX2)
+	if (ga_cpu::get_tier() >= k_cpu_tier_avx2)
+	{
+		bound = { _test_boxes_avx2, _test_spheres_avx2 };
+	}
+#endif
+	return bound;
+}
+
+// All paths sum in the same order, so they classify boundary cases alike.
+static ga_frustum_test _test_box(const ga_frustum& f, float cx, float cy, float cz, float ex, float ey, float ez)
+{
+	ga_frustum_test result = k_frustum_inside;
+	for (int p = 0; p < 6; ++p)
+	{
+		const ga_vec4f& plane = f.planes[p];
+		float distance = (plane.x * cx + plane.y * cy) + (plane.z * cz + plane.w);
+		float radius = (ga_absf(plane.x) * ex + ga_absf(plane.y) * ey) + ga_absf(plane.z) * ez;
+		if (distance + radius < 0.0f)
+		{
+			return k_frustum_outside;
+		}
+		if (distance - radius < 0.0f)
+		{
+			result = k_frustum_intersects;
+		}
+	}
+	return result;
+}
+
+static ga_frustum_test _test_sphere(const ga_frustum& f, float cx, float cy, float cz, float r)
+{
+	ga_frustum_test result = k_frustum_inside;
+	for (int p = 0; p < 6; ++p)
+	{
+		const ga_vec4f& plane = f.planes[p];
+		float distance = (plane.x * cx + plane.y * cy) + (plane.z * cz + plane.w);
+		if (distance + r < 0.0f)
+		{
+			return k_frustum_outside;
+		}
+		if (distance - r < 0.0f)
+		{
+			result = k_frustum_intersects;
+		}
+	}
+	return result;
+}
+
+static int _test_boxes_scalar(const ga_frustum&, const ga_aabb_soa&, uint8_t*)
+{
+	// scalar kernels take none; the caller tests the rest one at a time
+	return 0;
+}
+
+static int _test_spheres_scalar(const ga_frustum&, const ga_sphere_soa&, uint8_t*)
+{
+	// scalar kernels take none; the caller tests the rest one at a time
+	return 0;
+}
+
+#if defined(GA_SSE2)
+static int _test_boxes_sse2(const ga_frustum& f, const ga_aabb_soa& boxes, uint8_t* results)
+{
+	const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	const __m128 zero = _mm_setzero_ps();
+
+	int count = boxes.size();
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 cx = _mm_loadu_ps(&boxes.center_x[i]);
+		__m128 cy = _mm_loadu_ps(&boxes.center_y[i]);
+		__m128 cz = _mm_loadu_ps(&boxes.center_z[i]);
+		__m128 ex = _mm_loadu_ps(&boxes.extent_x[i]);
+		__m128 ey = _mm_loadu_ps(&boxes.extent_y[i]);
+		__m128 ez = _mm_loadu_ps(&boxes.extent_z[i]);
+
+		// outside if entirely behind any plane, inside if in front of all
+		__m128 outside = zero;
+		__m128 inside = _mm_cmpeq_ps(zero, zero);
+		for (int p = 0; p < 6; ++p)
+		{
+			__m128 a = _mm_set1_ps(f.planes[p].x);
+			__m128 b = _mm_set1_ps(f.planes[p].y);
+			__m128 c = _mm_set1_ps(f.planes[p].z);
+			__m128 d = _mm_set1_ps(f.planes[p].w);
+
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, cx), _mm_mul_ps(b, cy)),
+				_mm_add_ps(_mm_mul_ps(c, cz), d));
+			__m128 radius = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(_mm_and_ps(a, abs_mask), ex),
+				_mm_mul_ps(_mm_and_ps(b, abs_mask), ey)),
+				_mm_mul_ps(_mm_and_ps(c, abs_mask), ez));
+
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+			inside = _mm_andnot_ps(_mm_cmplt_ps(_mm_sub_ps(distance, radius), zero), inside);
+		}
+
+		__m128i classes = _classify4(outside, inside);
+		classes = _mm_packus_epi16(_mm_packs_epi32(classes, classes), classes);
+		int packed = _mm_cvtsi128_si32(classes);
+		memcpy(results + i, &packed, 4);
+	}
+	return i;
+}
+
+static int _test_spheres_sse2(const ga_frustum& f, const ga_sphere_soa& spheres, uint8_t* results)
+{
+	const __m128 zero = _mm_setzero_ps();
+
+	int count = spheres.size();
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 cx = _mm_loadu_ps(&spheres.center_x[i]);
+		__m128 cy = _mm_loadu_ps(&spheres.center_y[i]);
+		__m128 cz = _mm_loadu_ps(&spheres.center_z[i]);
+		__m128 r = _mm_loadu_ps(&spheres.radius[i]);
+
+		__m128 outside = zero;
+		__m128 inside = _mm_cmpeq_ps(zero, zero);
+		for (int p = 0; p < 6; ++p)
+		{
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(f.planes[p].x), cx), _mm_mul_ps(_mm_set1_ps(f.planes[p].y), cy)),
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(f.planes[p].z), cz), _mm_set1_ps(f.planes[p].w)));
+
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, r), zero));
+			inside = _mm_andnot_ps(_mm_cmplt_ps(_mm_sub_ps(distance, r), zero), inside);
+		}
+
+		__m128i classes = _classify4(outside, inside);
+		classes = _mm_packus_epi16(_mm_packs_epi32(classes, classes), classes);
+		int packed = _mm_cvtsi128_si32(classes);
+		memcpy(results + i, &packed, 4);
+	}
+	return i;
+}
+
+// ga_frustum_test per lane from the plane masks
+static inline __m128i _classify4(__m128 outside, __m128 inside)
+{
+	// 1, or 2 where inside; then 0 where outside
+	__m128i classes = _mm_sub_epi32(_mm_set1_epi32(k_frustum_intersects), _mm_castps_si128(inside));
+	return _mm_andnot_si128(_mm_castps_si128(outside), classes);
+}
+#endif
+
+#if defined(GA_AVX2)
+GA_TARGET_AVX2 static int _test_boxes_avx2(const ga_frustum& f, const ga_aabb_soa& boxes, uint8_t* results)
+{
+	const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	const __m256 zero = _mm256_setzero_ps();
+
+	int count = boxes.size();
+	int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 cx = _mm256_loadu_ps(&boxes.center_x[i]);
+		__m256 cy = _mm256_loadu_ps(&boxes.center_y[i]);
+		__m256 cz = _mm256_loadu_ps(&boxes.center_z[i]);
+		__m256 ex = _mm256_loadu_ps(&boxes.extent_x[i]);
+		__m256 ey = _mm256_loadu_ps(&boxes.extent_y[i]);
+		__m256 ez = _mm256_loadu_ps(&boxes.extent_z[i]);
+
+		__m256 outside = zero;
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; ++p)
+		{
+			__m256 a = _mm256_set1_ps(f.planes[p].x);
+			__m256 b = _mm256_set1_ps(f.planes[p].y);
+			__m256 c = _mm256_set1_ps(f.planes[p].z);
+			__m256 d = _mm256_set1_ps(f.planes[p].w);
+
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, cx), _mm256_mul_ps(b, cy)),
+				_mm256_add_ps(_mm256_mul_ps(c, cz), d));
+			__m256 radius = _mm256_add_ps(_mm256_add_ps(
+				_mm256_mul_ps(_mm256_and_ps(a, abs_mask), ex),
+				_mm256_mul_ps(_mm256_and_ps(b, abs_mask), ey)),
+				_mm256_mul_ps(_mm256_and_ps(c, abs_mask), ez));
+
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+			inside = _mm256_andnot_ps(_mm256_cmp_ps(_mm256_sub_ps(distance, radius), zero, _CMP_LT_OQ), inside);
+		}
+
+		_store_classes8(results + i, outside, inside);
+	}
+	return i;
+}
+
+GA_TARGET_AVX2 static int _test_spheres_avx2(const ga_frustum& f, const ga_sphere_soa& spheres, uint8_t* results)
+{
+	const __m256 zero = _mm256_setzero_ps();
+
+	int count = spheres.size();
+	int i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 cx = _mm256_loadu_ps(&spheres.center_x[i]);
+		__m256 cy = _mm256_loadu_ps(&spheres.center_y[i]);
+		__m256 cz = _mm256_loadu_ps(&spheres.center_z[i]);
+		__m256 r = _mm256_loadu_ps(&spheres.radius[i]);
+
+		__m256 outside = zero;
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; ++p)
+		{
+			__m256 distance = _mm256_add_ps(
+				_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(f.planes[p].x), cx), _mm256_mul_ps(_mm256_set1_ps(f.planes[p].y), cy)),
+				_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(f.planes[p].z), cz), _mm256_set1_ps(f.planes[p].w)));
+
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, r), zero, _CMP_LT_OQ));
+			inside = _mm256_andnot_ps(_mm256_cmp_ps(_mm256_sub_ps(distance, r), zero, _CMP_LT_OQ), inside);
+		}
+
+		_store_classes8(results + i, outside, inside);
+	}
+	return i;
+}
+
+GA_TARGET_AVX2 static inline void _store_classes8(uint8_t* results, __m256 outside, __m256 inside)
+{
+	__m256i classes = _mm256_sub_epi32(_mm256_set1_epi32(k_frustum_intersects), _mm256_castps_si256(inside));
+	classes = _mm256_andnot_si256(_mm256_castps_si256(outside), classes);
+
+	// narrow the eight lanes to bytes
+	__m128i words = _mm_packs_epi32(_mm256_castsi256_si128(classes), _mm256_extracti128_si256(classes, 1));
+	_mm_storel_epi64((__m128i*) results, _mm_packus_epi16(words, words));
+}
+#endif
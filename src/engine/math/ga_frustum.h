@@ -0,0 +1,57 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "math/ga_aabb.h"
+#include "math/ga_sphere.h"
+#include "math/ga_vec4f.h"
+
+#include <cstdint>
+
+/*
+** Where a volume lies relative to a frustum.
+*/
+enum ga_frustum_test
+{
+	k_frustum_outside,
+	k_frustum_intersects,
+	k_frustum_inside,
+};
+
+/*
+** View frustum as six inward facing planes.
+*/
+struct ga_frustum
+{
+	// (a, b, c, d) with a * x + b * y + c * z + d >= 0 inside, and (a, b, c)
+	// unit length so distances are comparable between planes
+	ga_vec4f planes[6];
+
+	/*
+	** Extract the frustum of a view-projection matrix.
+	*/
+	void make_from_view_projection(const struct ga_mat4f& __restrict view_proj);
+
+	/*
+	** Classify a single volume.
+	*/
+	ga_frustum_test test_box(const ga_aabb& __restrict box) const;
+	ga_frustum_test test_sphere(const ga_sphere& __restrict sphere) const;
+
+	/*
+	** Classify every volume in a batch, writing a ga_frustum_test to each
+	** result. Returns how many aren't outside.
+	**
+	** Classification is identical to the single volume tests, whichever
+	** instruction set runs it.
+	*/
+	int test_boxes(const ga_aabb_soa& __restrict boxes, uint8_t* __restrict results) const;
+	int test_spheres(const ga_sphere_soa& __restrict spheres, uint8_t* __restrict results) const;
+};
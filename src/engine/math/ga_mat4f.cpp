@@ -11,6 +11,36 @@
 
 #include "math/ga_math.h"
 
+#include "framework/ga_compiler_defines.h"
+#include "framework/ga_cpu.h"
+
+#if defined(GA_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(GA_AVX2)
+#include <immintrin.h>
+#endif
+
+// batch kernels, by whether they keep w
+typedef void (*transform_points4_t)(const ga_mat4f& m, const ga_vec3f* in, ga_vec4f* out, int count);
+typedef void (*transform_points3_t)(const ga_mat4f& m, const ga_vec3f* in, ga_vec3f* out, int count);
+
+static transform_points4_t _bind_transform_points4();
+static transform_points3_t _bind_transform_points3();
+static void _transform_points4_scalar(const ga_mat4f& m, const ga_vec3f* in, ga_vec4f* out, int count);
+static void _transform_points3_scalar(const ga_mat4f& m, const ga_vec3f* in, ga_vec3f* out, int count);
+#if defined(GA_SSE2)
+static void _transform_points4_sse2(const ga_mat4f& m, const ga_vec3f* in, ga_vec4f* out, int count);
+static void _transform_points3_sse2(const ga_mat4f& m, const ga_vec3f* in, ga_vec3f* out, int count);
+static __m128 _transform_point4(__m128 row0, __m128 row1, __m128 row2, __m128 row3, const ga_vec3f& in);
+#endif
+#if defined(GA_AVX2)
+GA_TARGET_AVX2 static void _transform_points4_avx2(const ga_mat4f& m, const ga_vec3f* in, ga_vec4f* out, int count);
+GA_TARGET_AVX2 static void _transform_points3_avx2(const ga_mat4f& m, const ga_vec3f* in, ga_vec3f* out, int count);
+GA_TARGET_AVX2 static __m256 _transform_point8(__m256 row0, __m256 row1, __m256 row2, __m256 row3,
+	const ga_vec3f& a, const ga_vec3f& b);
+#endif
+
 //#define GA_CLIP_SPACE_DX 1
 #define GA_CLIP_SPACE_GL 1
 
@@ -84,6 +114,21 @@ void ga_mat4f::rotate(const ga_quatf& __restrict q)
 ga_mat4f ga_mat4f::operator*(const ga_mat4f& __restrict b) const
 {
 	ga_mat4f result;
+#if defined(GA_SSE2)
+	// each row of the result is a combination of b's rows
+	__m128 b0 = _mm_loadu_ps(b.data[0]);
+	__m128 b1 = _mm_loadu_ps(b.data[1]);
+	__m128 b2 = _mm_loadu_ps(b.data[2]);
+	__m128 b3 = _mm_loadu_ps(b.data[3]);
+	for (int i = 0; i < 4; ++i)
+	{
+		__m128 row = _mm_mul_ps(_mm_set1_ps(data[i][0]), b0);
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(data[i][1]), b1));
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(data[i][2]), b2));
+		row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(data[i][3]), b3));
+		_mm_storeu_ps(result.data[i], row);
+	}
+#else
 	for (int i = 0; i < 4; ++i)
 	{
 		for (int j = 0; j < 4; ++j)
@@ -96,6 +141,7 @@ ga_mat4f ga_mat4f::operator*(const ga_mat4f& __restrict b) const
 			result.data[i][j] = tmp;
 		}
 	}
+#endif
 	return result;
 }
 
@@ -108,10 +154,18 @@ ga_mat4f& ga_mat4f::operator*=(const ga_mat4f& __restrict m)
 ga_vec4f ga_mat4f::transform(const ga_vec4f& __restrict in) const
 {
 	ga_vec4f result;
+#if defined(GA_SSE2)
+	__m128 r = _mm_mul_ps(_mm_set1_ps(in.x), _mm_loadu_ps(data[0]));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(in.y), _mm_loadu_ps(data[1])));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(in.z), _mm_loadu_ps(data[2])));
+	r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(in.w), _mm_loadu_ps(data[3])));
+	_mm_storeu_ps(result.axes, r);
+#else
 	result.x = in.x * data[0][0] + in.y * data[1][0] + in.z * data[2][0] + in.w * data[3][0];
 	result.y = in.x * data[0][1] + in.y * data[1][1] + in.z * data[2][1] + in.w * data[3][1];
 	result.z = in.x * data[0][2] + in.y * data[1][2] + in.z * data[2][2] + in.w * data[3][2];
 	result.w = in.x * data[0][3] + in.y * data[1][3] + in.z * data[2][3] + in.w * data[3][3];
+#endif
 	return result;
 }
 
@@ -129,6 +183,71 @@ ga_vec3f ga_mat4f::transform_point(const ga_vec3f& __restrict in) const
 	return{ temp.x, temp.y, temp.z };
 }
 
+void ga_mat4f::transform_points(const ga_vec3f* __restrict in, ga_vec4f* __restrict out, int count) const
+{
+	static const transform_points4_t kernel = _bind_transform_points4();
+	kernel(*this, in, out, count);
+}
+
+void ga_mat4f::transform_points(const ga_vec3f* __restrict in, ga_vec3f* __restrict out, int count) const
+{
+	static const transform_points3_t kernel = _bind_transform_points3();
+	kernel(*this, in, out, count);
+}
+
+void ga_mat4f::transform_aabbs(const ga_vec3f* __restrict min, const ga_vec3f* __restrict max,
+	ga_vec3f* __restrict out_min, ga_vec3f* __restrict out_max, int count) const
+{
+	// Arvo's method: each axis of each row adds its smaller and larger term
+	// to the translation.
+#if defined(GA_SSE2)
+	__m128 row0 = _mm_loadu_ps(data[0]);
+	__m128 row1 = _mm_loadu_ps(data[1]);
+	__m128 row2 = _mm_loadu_ps(data[2]);
+	__m128 row3 = _mm_loadu_ps(data[3]);
+
+	for (int i = 0; i < count; ++i)
+	{
+		__m128 a0 = _mm_mul_ps(_mm_set1_ps(min[i].x), row0);
+		__m128 b0 = _mm_mul_ps(_mm_set1_ps(max[i].x), row0);
+		__m128 a1 = _mm_mul_ps(_mm_set1_ps(min[i].y), row1);
+		__m128 b1 = _mm_mul_ps(_mm_set1_ps(max[i].y), row1);
+		__m128 a2 = _mm_mul_ps(_mm_set1_ps(min[i].z), row2);
+		__m128 b2 = _mm_mul_ps(_mm_set1_ps(max[i].z), row2);
+
+		__m128 lo = _mm_add_ps(row3, _mm_min_ps(a0, b0));
+		lo = _mm_add_ps(lo, _mm_min_ps(a1, b1));
+		lo = _mm_add_ps(lo, _mm_min_ps(a2, b2));
+		__m128 hi = _mm_add_ps(row3, _mm_max_ps(a0, b0));
+		hi = _mm_add_ps(hi, _mm_max_ps(a1, b1));
+		hi = _mm_add_ps(hi, _mm_max_ps(a2, b2));
+
+		alignas(16) float lo_out[4], hi_out[4];
+		_mm_store_ps(lo_out, lo);
+		_mm_store_ps(hi_out, hi);
+		out_min[i] = { lo_out[0], lo_out[1], lo_out[2] };
+		out_max[i] = { hi_out[0], hi_out[1], hi_out[2] };
+	}
+#else
+	for (int i = 0; i < count; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			float lo = data[3][j], hi = data[3][j];
+			for (int k = 0; k < 3; ++k)
+			{
+				float a = min[i].axes[k] * data[k][j];
+				float b = max[i].axes[k] * data[k][j];
+				lo += a < b ? a : b;
+				hi += a < b ? b : a;
+			}
+			out_min[i].axes[j] = lo;
+			out_max[i].axes[j] = hi;
+		}
+	}
+#endif
+}
+
 void ga_mat4f::transpose()
 {
 	ga_mat4f tmp;
@@ -144,6 +263,75 @@ void ga_mat4f::transpose()
 
 void ga_mat4f::invert()
 {
+#if defined(GA_SSE2)
+	// Blockwise inversion of the four 2x2 submatrices, each held in one
+	// register as (m00, m01, m10, m11).
+	#define GA_SWIZZLE(v, x, y, z, w) _mm_shuffle_ps(v, v, _MM_SHUFFLE(w, z, y, x))
+	#define GA_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+
+	__m128 m0 = _mm_loadu_ps(data[0]);
+	__m128 m1 = _mm_loadu_ps(data[1]);
+	__m128 m2 = _mm_loadu_ps(data[2]);
+	__m128 m3 = _mm_loadu_ps(data[3]);
+
+	__m128 A = _mm_movelh_ps(m0, m1);
+	__m128 B = _mm_movehl_ps(m1, m0);
+	__m128 C = _mm_movelh_ps(m2, m3);
+	__m128 D = _mm_movehl_ps(m3, m2);
+
+	// determinants of A, B, C and D
+	__m128 det_sub = _mm_sub_ps(
+		_mm_mul_ps(GA_SHUFFLE(m0, m2, 0, 2, 0, 2), GA_SHUFFLE(m1, m3, 1, 3, 1, 3)),
+		_mm_mul_ps(GA_SHUFFLE(m0, m2, 1, 3, 1, 3), GA_SHUFFLE(m1, m3, 0, 2, 0, 2)));
+	__m128 det_a = GA_SWIZZLE(det_sub, 0, 0, 0, 0);
+	__m128 det_b = GA_SWIZZLE(det_sub, 1, 1, 1, 1);
+	__m128 det_c = GA_SWIZZLE(det_sub, 2, 2, 2, 2);
+	__m128 det_d = GA_SWIZZLE(det_sub, 3, 3, 3, 3);
+
+	// adj(D) * C and adj(A) * B
+	__m128 d_c = _mm_sub_ps(_mm_mul_ps(GA_SWIZZLE(D, 3, 3, 0, 0), C),
+		_mm_mul_ps(GA_SWIZZLE(D, 1, 1, 2, 2), GA_SWIZZLE(C, 2, 3, 0, 1)));
+	__m128 a_b = _mm_sub_ps(_mm_mul_ps(GA_SWIZZLE(A, 3, 3, 0, 0), B),
+		_mm_mul_ps(GA_SWIZZLE(A, 1, 1, 2, 2), GA_SWIZZLE(B, 2, 3, 0, 1)));
+
+	// X = det(D) * A - B * (adj(D) * C), W = det(A) * D - C * (adj(A) * B)
+	__m128 x = _mm_sub_ps(_mm_mul_ps(det_d, A), _mm_add_ps(
+		_mm_mul_ps(B, GA_SWIZZLE(d_c, 0, 3, 0, 3)),
+		_mm_mul_ps(GA_SWIZZLE(B, 1, 0, 3, 2), GA_SWIZZLE(d_c, 2, 1, 2, 1))));
+	__m128 w = _mm_sub_ps(_mm_mul_ps(det_a, D), _mm_add_ps(
+		_mm_mul_ps(C, GA_SWIZZLE(a_b, 0, 3, 0, 3)),
+		_mm_mul_ps(GA_SWIZZLE(C, 1, 0, 3, 2), GA_SWIZZLE(a_b, 2, 1, 2, 1))));
+
+	// Y = det(B) * C - D * adj(adj(A) * B), Z = det(C) * B - A * adj(adj(D) * C)
+	__m128 y = _mm_sub_ps(_mm_mul_ps(det_b, C), _mm_sub_ps(
+		_mm_mul_ps(D, GA_SWIZZLE(a_b, 3, 0, 3, 0)),
+		_mm_mul_ps(GA_SWIZZLE(D, 1, 0, 3, 2), GA_SWIZZLE(a_b, 2, 1, 2, 1))));
+	__m128 z = _mm_sub_ps(_mm_mul_ps(det_c, B), _mm_sub_ps(
+		_mm_mul_ps(A, GA_SWIZZLE(d_c, 3, 0, 3, 0)),
+		_mm_mul_ps(GA_SWIZZLE(A, 1, 0, 3, 2), GA_SWIZZLE(d_c, 2, 1, 2, 1))));
+
+	// det(M) = det(A) det(D) + det(B) det(C) - tr((adj(A) * B) * (adj(D) * C))
+	__m128 det = _mm_add_ps(_mm_mul_ps(det_a, det_d), _mm_mul_ps(det_b, det_c));
+	__m128 trace = _mm_mul_ps(a_b, GA_SWIZZLE(d_c, 0, 2, 1, 3));
+	trace = _mm_add_ps(trace, GA_SWIZZLE(trace, 2, 3, 0, 1));
+	trace = _mm_add_ps(trace, GA_SWIZZLE(trace, 1, 0, 3, 2));
+	det = _mm_sub_ps(det, trace);
+
+	// the adjugate's signs alternate across each 2x2 block
+	__m128 inv_det = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det);
+	x = _mm_mul_ps(x, inv_det);
+	y = _mm_mul_ps(y, inv_det);
+	z = _mm_mul_ps(z, inv_det);
+	w = _mm_mul_ps(w, inv_det);
+
+	_mm_storeu_ps(data[0], GA_SHUFFLE(x, y, 3, 1, 3, 1));
+	_mm_storeu_ps(data[1], GA_SHUFFLE(x, y, 2, 0, 2, 0));
+	_mm_storeu_ps(data[2], GA_SHUFFLE(z, w, 3, 1, 3, 1));
+	_mm_storeu_ps(data[3], GA_SHUFFLE(z, w, 2, 0, 2, 0));
+
+	#undef GA_SWIZZLE
+	#undef GA_SHUFFLE
+#else
 	float s[6];
 	s[0] = data[0][0] * data[1][1] - data[1][0] * data[0][1];
 	s[1] = data[0][0] * data[1][2] - data[1][0] * data[0][2];
@@ -186,6 +374,7 @@ void ga_mat4f::invert()
 	tmp.data[3][3] = (data[2][0] * s[3] - data[2][1] * s[1] + data[2][2] * s[0])  * inv_det;
 
 	(*this) = tmp;
+#endif
 }
 
 ga_mat4f ga_mat4f::inverse() const
@@ -340,3 +529,153 @@ ga_vec3f ga_mat4f::get_right() const
 {
 	return{ data[0][0], data[0][1], data[0][2] };
 }
+
+static transform_points4_t _bind_transform_points4()
+{
+#if defined(GA_AVX2)
+	if (ga_cpu::get_tier() >= k_cpu_tier_avx2)
+	{
+		return _transform_points4_avx2;
+	}
+#endif
+#if defined(GA_SSE2)
+	if (ga_cpu::get_tier() >= k_cpu_tier_sse2)
+	{
+		return _transform_points4_sse2;
+	}
+#endif
+	return _transform_points4_scalar;
+}
+
+static transform_points3_t _bind_transform_points3()
+{
+#if defined(GA_AVX2)
+	if (ga_cpu::get_tier() >= k_cpu_tier_avx2)
+	{
+		return _transform_points3_avx2;
+	}
+#endif
+#if defined(GA_SSE2)
+	if (ga_cpu::get_tier() >= k_cpu_tier_sse2)
+	{
+		return _transform_points3_sse2;
+	}
+#endif
+	return _transform_points3_scalar;
+}
+
+static void _transform_points4_scalar(const ga_mat4f& m, const ga_vec3f* in, ga_vec4f* out, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		out[i] = m.transform({ in[i].x, in[i].y, in[i].z, 1.0f });
+	}
+}
+
+static void _transform_points3_scalar(const ga_mat4f& m, const ga_vec3f* in, ga_vec3f* out, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		out[i] = m.transform_point(in[i]);
+	}
+}
+
+// The vector kernels sum the rows in the same order as transform, so every
+// tier gives the same result.
+#if defined(GA_SSE2)
+static void _transform_points4_sse2(const ga_mat4f& m, const ga_vec3f* in, ga_vec4f* out, int count)
+{
+	__m128 row0 = _mm_loadu_ps(m.data[0]);
+	__m128 row1 = _mm_loadu_ps(m.data[1]);
+	__m128 row2 = _mm_loadu_ps(m.data[2]);
+	__m128 row3 = _mm_loadu_ps(m.data[3]);
+
+	for (int i = 0; i < count; ++i)
+	{
+		_mm_storeu_ps(out[i].axes, _transform_point4(row0, row1, row2, row3, in[i]));
+	}
+}
+
+static void _transform_points3_sse2(const ga_mat4f& m, const ga_vec3f* in, ga_vec3f* out, int count)
+{
+	__m128 row0 = _mm_loadu_ps(m.data[0]);
+	__m128 row1 = _mm_loadu_ps(m.data[1]);
+	__m128 row2 = _mm_loadu_ps(m.data[2]);
+	__m128 row3 = _mm_loadu_ps(m.data[3]);
+
+	// a full register store spills w into the next point's x, which its own
+	// store then overwrites; the last point can't spill past the end
+	int i = 0;
+	for (; i + 1 < count; ++i)
+	{
+		_mm_storeu_ps(out[i].axes, _transform_point4(row0, row1, row2, row3, in[i]));
+	}
+	for (; i < count; ++i)
+	{
+		out[i] = m.transform_point(in[i]);
+	}
+}
+
+static inline __m128 _transform_point4(__m128 row0, __m128 row1, __m128 row2, __m128 row3, const ga_vec3f& in)
+{
+	__m128 result = _mm_mul_ps(_mm_set1_ps(in.x), row0);
+	result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(in.y), row1));
+	result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(in.z), row2));
+	return _mm_add_ps(result, row3);
+}
+#endif
+
+#if defined(GA_AVX2)
+GA_TARGET_AVX2 static void _transform_points4_avx2(const ga_mat4f& m, const ga_vec3f* in, ga_vec4f* out, int count)
+{
+	// two points a register, one in each half
+	__m256 row0 = _mm256_broadcast_ps((const __m128*) m.data[0]);
+	__m256 row1 = _mm256_broadcast_ps((const __m128*) m.data[1]);
+	__m256 row2 = _mm256_broadcast_ps((const __m128*) m.data[2]);
+	__m256 row3 = _mm256_broadcast_ps((const __m128*) m.data[3]);
+
+	int i = 0;
+	for (; i + 2 <= count; i += 2)
+	{
+		_mm256_storeu_ps(out[i].axes, _transform_point8(row0, row1, row2, row3, in[i], in[i + 1]));
+	}
+	for (; i < count; ++i)
+	{
+		out[i] = m.transform({ in[i].x, in[i].y, in[i].z, 1.0f });
+	}
+}
+
+GA_TARGET_AVX2 static void _transform_points3_avx2(const ga_mat4f& m, const ga_vec3f* in, ga_vec3f* out, int count)
+{
+	__m256 row0 = _mm256_broadcast_ps((const __m128*) m.data[0]);
+	__m256 row1 = _mm256_broadcast_ps((const __m128*) m.data[1]);
+	__m256 row2 = _mm256_broadcast_ps((const __m128*) m.data[2]);
+	__m256 row3 = _mm256_broadcast_ps((const __m128*) m.data[3]);
+
+	// as the SSE2 kernel, each half's w spills into the next point
+	int i = 0;
+	for (; i + 2 < count; i += 2)
+	{
+		__m256 result = _transform_point8(row0, row1, row2, row3, in[i], in[i + 1]);
+		_mm_storeu_ps(out[i].axes, _mm256_castps256_ps128(result));
+		_mm_storeu_ps(out[i + 1].axes, _mm256_extractf128_ps(result, 1));
+	}
+	for (; i < count; ++i)
+	{
+		out[i] = m.transform_point(in[i]);
+	}
+}
+
+GA_TARGET_AVX2 static inline __m256 _transform_point8(__m256 row0, __m256 row1, __m256 row2, __m256 row3,
+	const ga_vec3f& a, const ga_vec3f& b)
+{
+	__m256 x = _mm256_setr_m128(_mm_set1_ps(a.x), _mm_set1_ps(b.x));
+	__m256 y = _mm256_setr_m128(_mm_set1_ps(a.y), _mm_set1_ps(b.y));
+	__m256 z = _mm256_setr_m128(_mm_set1_ps(a.z), _mm_set1_ps(b.z));
+
+	__m256 result = _mm256_mul_ps(x, row0);
+	result = _mm256_add_ps(result, _mm256_mul_ps(y, row1));
+	result = _mm256_add_ps(result, _mm256_mul_ps(z, row2));
+	return _mm256_add_ps(result, row3);
+}
+#endif
@@ -83,6 +83,26 @@ struct ga_mat4f
 	*/
 	ga_vec3f transform_point(const ga_vec3f& __restrict in) const;
 
+	/*
+	** Transform count points, as vectors with w = 1.
+	**
+	** Keeps the homogeneous result, so projections can be divided through
+	** and clipped by the caller.
+	*/
+	void transform_points(const ga_vec3f* __restrict in, ga_vec4f* __restrict out, int count) const;
+
+	/*
+	** Transform count points, as transform_point does.
+	*/
+	void transform_points(const ga_vec3f* __restrict in, ga_vec3f* __restrict out, int count) const;
+
+	/*
+	** Transform count axis-aligned boxes by an affine matrix, giving the
+	** smallest axis-aligned boxes holding the results.
+	*/
+	void transform_aabbs(const ga_vec3f* __restrict min, const ga_vec3f* __restrict max,
+		ga_vec3f* __restrict out_min, ga_vec3f* __restrict out_max, int count) const;
+
 	/*
 	** Transpose a matrix.
 	*/
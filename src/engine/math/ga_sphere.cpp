@@ -0,0 +1,39 @@
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "math/ga_sphere.h"
+
+bool ga_sphere::contains(const ga_vec3f& __restrict point) const
+{
+	ga_vec3f offset = point - center;
+	return offset.dot(offset) <= radius * radius;
+}
+
+bool ga_sphere::overlaps(const ga_sphere& __restrict b) const
+{
+	ga_vec3f offset = b.center - center;
+	float reach = radius + b.radius;
+	return offset.dot(offset) <= reach * reach;
+}
+
+void ga_sphere_soa::clear()
+{
+	center_x.clear();
+	center_y.clear();
+	center_z.clear();
+	radius.clear();
+}
+
+void ga_sphere_soa::push_back(const ga_sphere& __restrict sphere)
+{
+	center_x.push_back(sphere.center.x);
+	center_y.push_back(sphere.center.y);
+	center_z.push_back(sphere.center.z);
+	radius.push_back(sphere.radius);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+/*
+** RPI Game Architecture Engine
+**
+** Portions adapted from:
+** Viper Engine - Copyright (C) 2016 Velan Studios - All Rights Reserved
+**
+** This file is distributed under the MIT License. See LICENSE.txt.
+*/
+
+#include "math/ga_vec3f.h"
+
+#include <vector>
+
+/*
+** Bounding sphere.
+*/
+struct ga_sphere
+{
+	ga_vec3f center;
+	float radius;
+
+	/*
+	** Determine if a point is in the sphere, boundary included.
+	*/
+	bool contains(const ga_vec3f& __restrict point) const;
+
+	/*
+	** Determine if two spheres share any point.
+	*/
+	bool overlaps(const ga_sphere& __restrict b) const;
+};
+
+/*
+** Spheres stored as separate component arrays, for batch tests.
+*/
+struct ga_sphere_soa
+{
+	std::vector<float> center_x;
+	std::vector<float> center_y;
+	std::vector<float> center_z;
+	std::vector<float> radius;
+
+	/*
+	** Remove every sphere, keeping the storage.
+	*/
+	void clear();
+
+	void push_back(const ga_sphere& __restrict sphere);
+
+	int size() const { return (int) center_x.size(); }
+};
@@ -0,0 +1,495 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** A single streamed tile of terrain
+*/
+#include "ga_terrain_chunk.h"
+#include "ga_terrain_codec.h"
+#include "ga_terrain_field.h"
+#include "ga_terrain_mesh.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+template <int Detail> static int _generate_terrain(const ga_terrain_field* field, float* points, int size, int stride,
+	int old_stride, ga_vec2f center, float width, float* row_x, float* row_z, float* row_samples);
+template <int Detail> static void _fill_between_samples(float* points, int size, int stride);
+
+ga_terrain_chunk::ga_terrain_chunk(const ga_terrain_field* field, int x, int z)
+{
+	_field = field;
+
+	const ga_terrain_params& params = field->get_params();
+	_size = params._size;
+	_width = params._width;
+	_height = params._height;
+
+	_detail = params._detail;
+
+	_points = new float[_size * _size];
+	_wide_indices = false;
+	_gpu_mesh = 0;
+
+	// size everything for the full grid now, so refining never grows it
+	int quads = _size - 1;
+	_vertices.reserve(_size * _size);
+	if (ga_terrain_mesh::needs_wide_indices(_size))
+	{
+		_indices32.reserve(6 * quads * quads);
+	}
+	else
+	{
+		_indices.reserve(6 * quads * quads);
+	}
+	_row_x.resize(_size);
+	_row_z.resize(_size);
+	_row_samples.resize(_size);
+
+	reset(x, z);
+}
+
+ga_terrain_chunk::~ga_terrain_chunk()
+{
+	delete[] _points;
+}
+
+void ga_terrain_chunk::reset(int x, int z)
+{
+	_x = x;
+	_z = z;
+	_position = { x * _width, z * _width };
+	_stride = 0;
+	_edits.clear();
+	_eroded = false;
+	_relax_pending = false;
+}
+
+void ga_terrain_chunk::generate()
+{
+	generate_preview(0);
+}
+
+int ga_terrain_chunk::generate_preview(int coarse_levels)
+{
+	int generated = sample_preview(coarse_levels);
+	build_bounds();
+	build_mesh();
+
+	return generated;
+}
+
+int ga_terrain_chunk::refine()
+{
+	if (_stride <= 1)
+	{
+		return 0;
+	}
+
+	int generated = sample_refinement();
+	build_bounds();
+	build_mesh();
+
+	return generated;
+}
+
+int ga_terrain_chunk::sample_preview(int coarse_levels)
+{
+	int stride = 1 << std::min(coarse_levels, _detail);
+	_stride = 0;
+
+	// initialize the actual heightmap, at least the samples on the preview's grid
+	int generated = generate_terrain(stride);
+	_stride = stride;
+
+	return generated;
+}
+
+int ga_terrain_chunk::sample_refinement()
+{
+	assert(_stride > 1);
+
+	int generated = generate_terrain(_stride / 2);
+	_stride /= 2;
+
+	return generated;
+}
+
+void ga_terrain_chunk::compress(int bits, std::vector<uint8_t>& data) const
+{
+	assert(is_refined());
+
+	// the edits come back from the edit layer, so only the heights under them are kept
+	ga_terrain_codec::encode(get_base_heights(), _size, bits, data);
+}
+
+bool ga_terrain_chunk::decompress(const std::vector<uint8_t>& data)
+{
+	if (!ga_terrain_codec::decode(data, get_base(), _size))
+	{
+		return false;
+	}
+
+	_stride = 1;
+	_eroded = true;
+	apply_edits();
+	return true;
+}
+
+const std::vector<ga_terrain_erosion_tile>& ga_terrain_chunk::build_erosion_tiles()
+{
+	_erosion_tiles.clear();
+	if (!is_refined() || _eroded)
+	{
+		return _erosion_tiles;
+	}
+	_eroded = true;
+
+	const ga_terrain_params& params = _field->get_params();
+	_relax_pending = params._thermal_iterations > 0;
+	if (params._erosion > 0.0f)
+	{
+		// heights in chunk widths, the gentle slopes the droplet constants suit
+		ga_terrain_erosion::build_tiles(get_base(), _size, _x, _z, params._seed, params._erosion,
+			params._erosion_tile, (float) _height / _width, _erosion_tiles);
+	}
+
+	return _erosion_tiles;
+}
+
+void ga_terrain_chunk::finish_erosion()
+{
+	if (_relax_pending)
+	{
+		_relax_pending = false;
+
+		// the steepest slope allowed, as a difference between neighboring samples
+		const ga_terrain_params& params = _field->get_params();
+		float cell = _width / (float) (_size - 1);
+		float talus = std::tan(params._thermal_talus * 3.14159265f / 180.0f) * cell / (float) _height;
+
+		_relax_scratch.resize(_size * _size);
+		ga_terrain_erosion::relax(get_base(), &_relax_scratch[0], _size, params._thermal_iterations, talus);
+	}
+
+	// erosion only ever sees the field's heights; edits go on top after
+	apply_edits();
+}
+
+void ga_terrain_chunk::set_edits(const std::vector<float>* edits)
+{
+	if (edits == NULL)
+	{
+		// the heights under the old edits are the chunk's heights again
+		if (!_edits.empty() && _stride > 0)
+		{
+			std::copy(_base.begin(), _base.end(), _points);
+		}
+		_edits.clear();
+		return;
+	}
+
+	// an unedited chunk's heights are its base
+	if (_edits.empty() && _stride > 0)
+	{
+		_base.assign(_points, _points + _size * _size);
+	}
+
+	_edits.assign(edits->begin(), edits->end());
+	if (_stride > 0)
+	{
+		apply_edits();
+	}
+}
+
+float* ga_terrain_chunk::get_base()
+{
+	if (_edits.empty())
+	{
+		return _points;
+	}
+
+	_base.resize(_size * _size);
+	return &_base[0];
+}
+
+void ga_terrain_chunk::apply_edits()
+{
+	if (_edits.empty())
+	{
+		return;
+	}
+
+	// always from the base, so a chunk edited in place matches one generated with its edits
+	for (int i = 0; i < _size * _size; i++)
+	{
+		_points[i] = _base[i] + _edits[i];
+	}
+}
+
+void ga_terrain_chunk::build_bounds()
+{
+	// bound it for ray casts and culling
+	_pyramid.build(_points, _size, (float) _height, -_height / 2.0f);
+}
+
+void ga_terrain_chunk::build_mesh()
+{
+	// use the newly generated _points to setup vertices for drawing
+	setup_vertices();
+}
+
+int ga_terrain_chunk::generate_terrain(int stride)
+{
+	float* base = get_base();
+
+	// chunks of the common detail levels get loops with fixed trip counts
+	int generated;
+	switch (_detail)
+	{
+	case 4: generated = _generate_terrain<4>(_field, base, _size, stride, _stride, _position, _width, &_row_x[0], &_row_z[0], &_row_samples[0]); break;
+	case 5: generated = _generate_terrain<5>(_field, base, _size, stride, _stride, _position, _width, &_row_x[0], &_row_z[0], &_row_samples[0]); break;
+	case 6: generated = _generate_terrain<6>(_field, base, _size, stride, _stride, _position, _width, &_row_x[0], &_row_z[0], &_row_samples[0]); break;
+	case 7: generated = _generate_terrain<7>(_field, base, _size, stride, _stride, _position, _width, &_row_x[0], &_row_z[0], &_row_samples[0]); break;
+	case 8: generated = _generate_terrain<8>(_field, base, _size, stride, _stride, _position, _width, &_row_x[0], &_row_z[0], &_row_samples[0]); break;
+	case 9: generated = _generate_terrain<9>(_field, base, _size, stride, _stride, _position, _width, &_row_x[0], &_row_z[0], &_row_samples[0]); break;
+	default: generated = _generate_terrain<0>(_field, base, _size, stride, _stride, _position, _width, &_row_x[0], &_row_z[0], &_row_samples[0]); break;
+	}
+
+	apply_edits();
+	return generated;
+}
+
+void ga_terrain_chunk::setup_vertices()
+{
+	_vertices.clear();
+	_indices.clear();
+	_indices32.clear();
+
+	float max_error = _field->get_params()._rtin_error;
+	if (max_error > 0.0f)
+	{
+		// interpolated samples cost the triangulation nothing, so previews
+		// come out coarse on their own
+		setup_adaptive_vertices(max_error);
+		return;
+	}
+
+	// calculate x, y, z from _points data, on the current pass's grid
+	int size = (_size - 1) / _stride + 1;
+	_vertices.resize(size * size);
+	ga_terrain_mesh::build_vertices(_points, _size, _stride, _position.x, _position.y,
+		_width, (float) _height, -_height / 2.0f, &_vertices[0]);
+
+	// every grid of this size has the same indices, so copy the field's
+	_wide_indices = ga_terrain_mesh::needs_wide_indices(size);
+	if (_wide_indices)
+	{
+		const std::vector<uint32_t>& indices = _field->get_wide_grid_indices(_stride);
+		_indices32.assign(indices.begin(), indices.end());
+	}
+	else
+	{
+		const std::vector<uint16_t>& indices = _field->get_grid_indices(_stride);
+		_indices.assign(indices.begin(), indices.end());
+	}
+}
+
+void ga_terrain_chunk::setup_adaptive_vertices(float max_error)
+{
+	_rtin.build(_points, _size, (float) _height);
+
+	_triangles.clear();
+	_rtin.extract(max_error, _triangles);
+
+	// keep only the samples the triangulation uses, in order of first use
+	_remap.assign(_size * _size, -1);
+	for (uint32_t& index : _triangles)
+	{
+		if (_remap[index] < 0)
+		{
+			int x = index % _size;
+			int y = index / _size;
+			ga_vec2f pos = point_to_position(x, y) + _position;
+			float height = get_point(x, y) * _height - _height / 2.0f;
+
+			_remap[index] = (int) _vertices.size();
+			_vertices.push_back({ pos.x, height, pos.y });
+		}
+		index = _remap[index];
+	}
+
+	_wide_indices = _vertices.size() > 0xffff;
+	if (_wide_indices)
+	{
+		_indices32.swap(_triangles);
+	}
+	else
+	{
+		_indices.assign(_triangles.begin(), _triangles.end());
+	}
+}
+
+bool ga_terrain_chunk::is_strip() const
+{
+	// adaptive meshes are always triangle lists
+	const ga_terrain_params& params = _field->get_params();
+	return params._rtin_error <= 0.0f && ga_terrain_mesh::is_strip(params._index_order);
+}
+
+ga_vec3f ga_terrain_chunk::get_min() const
+{
+	return { _position.x - _width * 0.5f, _pyramid.get_min(), _position.y - _width * 0.5f };
+}
+
+ga_vec3f ga_terrain_chunk::get_max() const
+{
+	return { _position.x + _width * 0.5f, _pyramid.get_max(), _position.y + _width * 0.5f };
+}
+
+float ga_terrain_chunk::sample_height(float x, float z) const
+{
+	// convert to continuous grid coordinates within this chunk
+	float scale = (float) (_size - 1) / _width;
+	float u = (x - _position.x) * scale + (_size - 1) * 0.5f;
+	float v = (z - _position.y) * scale + (_size - 1) * 0.5f;
+
+	int i = (int) std::floor(u);
+	int j = (int) std::floor(v);
+	i = i < 0 ? 0 : (i > _size - 2 ? _size - 2 : i);
+	j = j < 0 ? 0 : (j > _size - 2 ? _size - 2 : j);
+
+	float fu = u - (float) i;
+	float fv = v - (float) j;
+
+	const float* row = _points + j * _size + i;
+	float top = row[0] + fu * (row[1] - row[0]);
+	float bottom = row[_size] + fu * (row[_size + 1] - row[_size]);
+	float sample = top + fv * (bottom - top);
+
+	return sample * _height - _height / 2.0f;
+}
+
+bool ga_terrain_chunk::raycast(const ga_vec3f& origin, const ga_vec3f& dir, float t_max, float* t) const
+{
+	// move the ray into grid space; scaling x and z leaves t unchanged
+	float inv_cell = (float) (_size - 1) / _width;
+	ga_vec3f grid_origin = {
+		(origin.x - _position.x + _width * 0.5f) * inv_cell,
+		origin.y,
+		(origin.z - _position.y + _width * 0.5f) * inv_cell
+	};
+	ga_vec3f grid_dir = { dir.x * inv_cell, dir.y, dir.z * inv_cell };
+
+	return _pyramid.raycast(grid_origin, grid_dir, t_max, t);
+}
+
+// getter/setter for _points
+float ga_terrain_chunk::get_point(int x, int y) const
+{
+	if (y * _size + x < _size * _size)
+		return _points[y * _size + x];
+	else
+		return 0.5f;
+}
+
+void ga_terrain_chunk::set_point(int x, int y, float height)
+{
+	assert(y * _size + x < _size * _size);
+	_points[y * _size + x] = height;
+}
+
+ga_vec2f ga_terrain_chunk::point_to_position(int x, int y) const
+{
+	ga_vec2f pos;
+	pos.x = _width * ((float) x / (float) (_size - 1) - 0.5f);
+	pos.y = _width * ((float) y / (float) (_size - 1) - 0.5f);
+
+	return pos;
+}
+
+template <int Detail>
+static int _generate_terrain(const ga_terrain_field* field, float* points, int size, int stride, int old_stride,
+	ga_vec2f center, float width, float* row_x, float* row_z, float* row_samples)
+{
+	// Detail 0 takes the chunk size at run time
+	const int n = Detail > 0 ? (1 << Detail) + 1 : size;
+	assert(n == size);
+
+	float cell = width / (float) (n - 1);
+	float half = width * 0.5f;
+	int generated = 0;
+
+	// initialize points pseudorandomly with Perlin noise, one row at a time,
+	// skipping samples an earlier pass already took
+	for (int j = 0; j < n; j += stride)
+	{
+		bool old_row = old_stride > 0 && j % old_stride == 0;
+		int first = old_row ? stride : 0;
+		int step = old_row ? 2 * stride : stride;
+
+		float z = center.y + ((float) j * cell - half);
+		int count = 0;
+		for (int i = first; i < n; i += step)
+		{
+			row_x[count] = center.x + ((float) i * cell - half);
+			row_z[count] = z;
+			count++;
+		}
+
+		field->get_samples(row_x, row_z, row_samples, count);
+
+		float* row = points + j * n;
+		for (int k = 0; k < count; k++)
+		{
+			row[first + k * step] = row_samples[k];
+		}
+		generated += count;
+	}
+
+	if (stride > 1)
+	{
+		_fill_between_samples<Detail>(points, n, stride);
+	}
+
+	return generated;
+}
+
+template <int Detail>
+static void _fill_between_samples(float* points, int size, int stride)
+{
+	const int n = Detail > 0 ? (1 << Detail) + 1 : size;
+
+	// fill everything off the stride grid bilinearly, so height queries, ray
+	// casts and the bounds see the same surface the preview mesh draws
+	for (int j = 0; j < n - 1; j += stride)
+	{
+		for (int i = 0; i < n - 1; i += stride)
+		{
+			float h00 = points[j * n + i];
+			float h10 = points[j * n + i + stride];
+			float h01 = points[(j + stride) * n + i];
+			float h11 = points[(j + stride) * n + i + stride];
+
+			for (int v = 0; v <= stride; v++)
+			{
+				float fv = (float) v / (float) stride;
+				float left = h00 + fv * (h01 - h00);
+				float right = h10 + fv * (h11 - h10);
+				float* row = points + (j + v) * n + i;
+
+				for (int u = 0; u <= stride; u++)
+				{
+					if ((u == 0 || u == stride) && (v == 0 || v == stride))
+					{
+						continue;
+					}
+
+					float fu = (float) u / (float) stride;
+					row[u] = left + fu * (right - left);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** A single streamed tile of terrain
+*/
+
+#include "terrain/ga_terrain_erosion.h"
+#include "terrain/ga_terrain_pyramid.h"
+#include "terrain/ga_terrain_rtin.h"
+
+#include "math/ga_vec2f.h"
+#include "math/ga_vec3f.h"
+
+#include <cstdint>
+#include <vector>
+
+/*
+** One square tile of terrain: a (2^detail + 1)^2 heightmap sampled from the
+** field, its min/max pyramid and the mesh used to draw it.
+** Chunk (x, z) is centered on world position (x * width, z * width).
+*/
+class ga_terrain_chunk
+{
+public:
+	ga_terrain_chunk(const class ga_terrain_field* field, int x, int z);
+	~ga_terrain_chunk();
+
+	/*
+	** Move the chunk to (x, z) for generating again, keeping its storage.
+	** Used by ga_terrain_chunk_pool.
+	*/
+	void reset(int x, int z);
+
+	/*
+	** Sample the heightmap, bound it and build the mesh.
+	*/
+	void generate();
+
+	/*
+	** Generate a preview from every 2^coarse_levels-th sample, interpolating
+	** the rest, then refine() adds detail one level per call, keeping the
+	** samples already taken. Both return the number of samples generated.
+	*/
+	int generate_preview(int coarse_levels);
+	int refine();
+	bool is_refined() const { return _stride == 1; }
+
+	/*
+	** The stages generate_preview() and refine() run, for callers that want
+	** to stop between them. Sampling returns the number of samples generated.
+	*/
+	int sample_preview(int coarse_levels);
+	int sample_refinement();
+	void build_bounds();
+	void build_mesh();
+
+	/*
+	** Compress the fully refined heightmap into data, quantized to bits, or
+	** replace the heightmap with one decompressed from it, returning false if
+	** it's from a chunk of another size. Bounds and mesh still need building
+	** after decompressing.
+	*/
+	void compress(int bits, std::vector<uint8_t>& data) const;
+	bool decompress(const std::vector<uint8_t>& data);
+
+	/*
+	** Give the chunk its offsets from the edit layer, or null for none.
+	** They're added on top of the field's heights, after any erosion, so a
+	** chunk edited in place matches one generated with the same offsets.
+	** Bounds and mesh still need building after changing them on a sampled
+	** chunk.
+	*/
+	void set_edits(const std::vector<float>* edits);
+
+	/*
+	** Tiles of hydraulic erosion to run over the heightmap once it's fully
+	** refined, if the field asks for erosion, or none if there's nothing to
+	** do, followed by finish_erosion() for thermal erosion, which then puts
+	** the edits back on top. Each chunk is eroded once; decompressed
+	** heightmaps already were. Bounds and mesh still need building after.
+	*/
+	const std::vector<ga_terrain_erosion_tile>& build_erosion_tiles();
+	void finish_erosion();
+
+	int get_x() const { return _x; }
+	int get_z() const { return _z; }
+
+	// size x size heightmap samples, in heightmap units, and the ones under
+	// the edits, which are the same for an unedited chunk
+	const float* get_heights() const { return _points; }
+	const float* get_base_heights() const { return _edits.empty() ? _points : &_base[0]; }
+
+	// world space bounds of the generated mesh
+	ga_vec3f get_min() const;
+	ga_vec3f get_max() const;
+
+	const std::vector<ga_vec3f>& get_vertices() const { return _vertices; }
+	/*
+	** Meshes with more vertices than 16-bit indices can address, such as full
+	** grids past detail 7, are indexed with get_wide_indices() instead.
+	*/
+	bool has_wide_indices() const { return _wide_indices; }
+	const std::vector<uint16_t>& get_indices() const { return _indices; }
+	const std::vector<uint32_t>& get_wide_indices() const { return _indices32; }
+
+	// whether the indices form restart-separated strips instead of a list
+	bool is_strip() const;
+
+	// GPU copy of the mesh, owned by the streaming pipeline
+	struct ga_terrain_gpu_mesh* get_gpu_mesh() const { return _gpu_mesh; }
+	void set_gpu_mesh(struct ga_terrain_gpu_mesh* mesh) { _gpu_mesh = mesh; }
+
+	/*
+	** Bilinearly sample the heightmap at world (x, z).
+	*/
+	float sample_height(float x, float z) const;
+
+	/*
+	** Intersect a world space ray with the chunk's mesh.
+	*/
+	bool raycast(const ga_vec3f& origin, const ga_vec3f& dir, float t_max, float* t) const;
+
+private:
+	// data and helpers for actually drawing the terrain
+	void setup_vertices();
+	void setup_adaptive_vertices(float max_error);
+	std::vector<ga_vec3f> _vertices;
+	std::vector<uint16_t> _indices;
+	std::vector<uint32_t> _indices32;
+	bool _wide_indices;
+	struct ga_terrain_gpu_mesh* _gpu_mesh;
+
+	// scratch space kept between generations so reused chunks don't allocate
+	std::vector<float> _row_x;
+	std::vector<float> _row_z;
+	std::vector<float> _row_samples;
+	std::vector<uint32_t> _triangles;
+	std::vector<int> _remap;
+
+	// copy of the edit layer's offsets, empty if the chunk is unedited, and
+	// the heights under them, which sampling and erosion work on instead of
+	// _points while there are any
+	std::vector<float> _edits;
+	std::vector<float> _base;
+	float* get_base();
+	void apply_edits();
+
+	std::vector<ga_terrain_erosion_tile> _erosion_tiles;
+	std::vector<float> _relax_scratch;
+	bool _eroded;
+	bool _relax_pending;
+
+	// Terrain representation
+	const class ga_terrain_field* _field;
+	int _x;
+	int _z;
+	int _size;
+	float _width;
+	int _height;
+	float* _points;
+	ga_terrain_pyramid _pyramid;
+	ga_terrain_rtin _rtin;
+	ga_vec2f _position;
+
+	// some helper getters/setters
+	float get_point(int x, int y) const;
+	void set_point(int x, int y, float height);
+	ga_vec2f point_to_position(int x, int y) const;
+
+	// spacing of the samples taken so far, 1 once fully refined
+	int _detail;
+	int _stride;
+
+	// and methods to generate terrain / vbo objects
+	int generate_terrain(int stride);
+};
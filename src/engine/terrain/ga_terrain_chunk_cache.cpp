@@ -0,0 +1,75 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Compressed chunks kept after leaving the view
+*/
+#include "ga_terrain_chunk_cache.h"
+#include "ga_terrain_codec.h"
+
+#include <cassert>
+#include <iterator>
+
+ga_terrain_chunk_cache::ga_terrain_chunk_cache(int budget, int bits)
+{
+	assert(bits >= ga_terrain_codec::k_min_bits && bits <= ga_terrain_codec::k_max_bits);
+
+	_budget = budget;
+	_bits = bits;
+	_bytes = 0;
+}
+
+std::vector<uint8_t>& ga_terrain_chunk_cache::insert(int x, int z)
+{
+	std::pair<int, int> key = std::make_pair(x, z);
+	auto found = _index.find(key);
+	if (found != _index.end())
+	{
+		erase(found->second);
+	}
+
+	_entries.push_front({ x, z, std::vector<uint8_t>() });
+	_index[key] = _entries.begin();
+	return _entries.front()._data;
+}
+
+void ga_terrain_chunk_cache::trim()
+{
+	// filled buffers could be anywhere after a restore, so recount them all
+	_bytes = 0;
+	for (const entry_t& entry : _entries)
+	{
+		_bytes += (int) entry._data.size();
+	}
+
+	while (_bytes > _budget && !_entries.empty())
+	{
+		erase(std::prev(_entries.end()));
+	}
+}
+
+bool ga_terrain_chunk_cache::take(int x, int z, std::vector<uint8_t>& data)
+{
+	auto found = _index.find(std::make_pair(x, z));
+	if (found == _index.end())
+	{
+		return false;
+	}
+
+	data.swap(found->second->_data);
+	erase(found->second);
+	return true;
+}
+
+void ga_terrain_chunk_cache::restore(int x, int z, std::vector<uint8_t>& data)
+{
+	insert(x, z).swap(data);
+	trim();
+}
+
+void ga_terrain_chunk_cache::erase(entry_list_t::iterator entry)
+{
+	_bytes -= (int) entry->_data.size();
+	_index.erase(std::make_pair(entry->_x, entry->_z));
+	_entries.erase(entry);
+}
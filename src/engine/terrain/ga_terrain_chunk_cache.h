@@ -0,0 +1,67 @@
+#pragma once
+
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Compressed chunks kept after leaving the view
+*/
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <utility>
+#include <vector>
+
+/*
+** Heightmaps of chunks that left the view, compressed by ga_terrain_codec,
+** so a camera turning back restores them instead of generating them again.
+** Holds at most budget bytes, dropping the least recently stored first.
+** Buffers handed out by insert() may be filled from other threads before
+** trim() is called; everything else is for the streamer only.
+*/
+class ga_terrain_chunk_cache
+{
+public:
+	ga_terrain_chunk_cache(int budget, int bits);
+
+	// bits per sample the heightmaps are quantized to
+	int get_bits() const { return _bits; }
+
+	// empty buffer for the chunk at (x, z) to be compressed into
+	std::vector<uint8_t>& insert(int x, int z);
+
+	// count the buffers filled since the last trim, and drop chunks until
+	// the rest fit the budget
+	void trim();
+
+	/*
+	** Swap the chunk at (x, z) into data and forget it, returning false if
+	** it isn't cached. restore() puts back one that went unused.
+	*/
+	bool take(int x, int z, std::vector<uint8_t>& data);
+	void restore(int x, int z, std::vector<uint8_t>& data);
+
+	int get_count() const { return (int) _entries.size(); }
+	int get_bytes() const { return _bytes; }
+
+private:
+	struct entry_t
+	{
+		int _x;
+		int _z;
+		std::vector<uint8_t> _data;
+	};
+
+	typedef std::list<entry_t> entry_list_t;
+
+	void erase(entry_list_t::iterator entry);
+
+	int _budget;
+	int _bits;
+	int _bytes;
+
+	// most recently stored first
+	entry_list_t _entries;
+	std::map<std::pair<int, int>, entry_list_t::iterator> _index;
+};
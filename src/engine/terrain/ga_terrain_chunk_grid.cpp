@@ -0,0 +1,110 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Registry of loaded terrain chunks
+*/
+#include "ga_terrain_chunk_grid.h"
+#include "ga_terrain_chunk.h"
+
+#include <cassert>
+#include <cmath>
+
+ga_terrain_chunk_grid::ga_terrain_chunk_grid(int radius)
+{
+	// loaded chunks span at most 2 * radius + 1 coordinates on each axis;
+	// round up to a power of two so wrapping is a mask
+	_dimension = 1;
+	while (_dimension < 2 * radius + 2)
+	{
+		_dimension <<= 1;
+	}
+	_mask = _dimension - 1;
+	_count = 0;
+
+	_slots = new ga_terrain_chunk_slot[_dimension * _dimension];
+	for (int i = 0; i < _dimension * _dimension; i++)
+	{
+		_slots[i]._x = 0;
+		_slots[i]._z = 0;
+		_slots[i]._chunk = 0;
+	}
+}
+
+ga_terrain_chunk_grid::~ga_terrain_chunk_grid()
+{
+	delete[] _slots;
+}
+
+void ga_terrain_chunk_grid::insert(int x, int z, ga_terrain_chunk* chunk)
+{
+	ga_terrain_chunk_slot& slot = _slots[get_slot_index(x, z)];
+
+	// a different chunk here means the streaming radius was exceeded
+	assert(slot._chunk == 0 || (slot._x == x && slot._z == z));
+
+	if (slot._chunk == 0)
+	{
+		_count++;
+	}
+
+	slot._x = x;
+	slot._z = z;
+	slot._chunk = chunk;
+}
+
+void ga_terrain_chunk_grid::remove(int x, int z)
+{
+	ga_terrain_chunk_slot& slot = _slots[get_slot_index(x, z)];
+	if (slot._chunk != 0 && slot._x == x && slot._z == z)
+	{
+		slot._chunk = 0;
+		_count--;
+	}
+}
+
+bool ga_terrain_chunk_grid::raycast(const ga_vec3f& origin, const ga_vec3f& dir, float width, float max_distance, float* t) const
+{
+	// walk the chunks under the ray in order with a 2D DDA, in chunk units
+	// where chunk k spans [k, k + 1)
+	float cx = origin.x / width + 0.5f;
+	float cz = origin.z / width + 0.5f;
+	int chunk_x = (int) std::floor(cx);
+	int chunk_z = (int) std::floor(cz);
+
+	float dx = dir.x / width;
+	float dz = dir.z / width;
+	int step_x = dx >= 0.0f ? 1 : -1;
+	int step_z = dz >= 0.0f ? 1 : -1;
+	float delta_x = dx != 0.0f ? std::fabs(1.0f / dx) : 1e30f;
+	float delta_z = dz != 0.0f ? std::fabs(1.0f / dz) : 1e30f;
+	float next_x = dx != 0.0f ? (step_x > 0 ? chunk_x + 1 - cx : cx - chunk_x) * delta_x : 1e30f;
+	float next_z = dz != 0.0f ? (step_z > 0 ? chunk_z + 1 - cz : cz - chunk_z) * delta_z : 1e30f;
+
+	float t_enter = 0.0f;
+	while (t_enter <= max_distance)
+	{
+		float t_exit = std::fmin(std::fmin(next_x, next_z), max_distance);
+
+		ga_terrain_chunk* chunk = find(chunk_x, chunk_z);
+		if (chunk != NULL && chunk->raycast(origin, dir, t_exit, t))
+		{
+			return true;
+		}
+
+		if (next_x < next_z)
+		{
+			t_enter = next_x;
+			next_x += delta_x;
+			chunk_x += step_x;
+		}
+		else
+		{
+			t_enter = next_z;
+			next_z += delta_z;
+			chunk_z += step_z;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Registry of loaded terrain chunks
+*/
+
+#include "math/ga_vec3f.h"
+
+/*
+** A loaded chunk and its chunk coordinates.
+*/
+struct ga_terrain_chunk_slot
+{
+	int _x;
+	int _z;
+	class ga_terrain_chunk* _chunk;
+};
+
+/*
+** Fixed-size toroidal grid of loaded chunks, keyed by chunk coordinates.
+** Chunks are only ever loaded within the streaming radius of the camera, so
+** wrapping coordinates into a grid wider than that diameter gives every
+** loaded chunk its own slot and makes lookup a single array access.
+*/
+class ga_terrain_chunk_grid
+{
+public:
+	ga_terrain_chunk_grid(int radius);
+	~ga_terrain_chunk_grid();
+
+	/*
+	** Get the chunk at chunk coordinates (x, z), or NULL if it isn't loaded.
+	*/
+	class ga_terrain_chunk* find(int x, int z) const
+	{
+		const ga_terrain_chunk_slot& slot = _slots[get_slot_index(x, z)];
+		return (slot._x == x && slot._z == z) ? slot._chunk : 0;
+	}
+
+	void insert(int x, int z, class ga_terrain_chunk* chunk);
+	void remove(int x, int z);
+
+	int get_count() const { return _count; }
+
+	/*
+	** Cast a ray against the chunks in the grid, each width wide, walking
+	** the ones under it in order and each one's min/max pyramid. Returns
+	** the nearest hit t within max_distance; missing chunks are empty space.
+	*/
+	bool raycast(const ga_vec3f& origin, const ga_vec3f& dir, float width, float max_distance, float* t) const;
+
+	// raw slot access for iterating over every loaded chunk
+	int get_slot_count() const { return _dimension * _dimension; }
+	const ga_terrain_chunk_slot& get_slot(int index) const { return _slots[index]; }
+
+private:
+	int get_slot_index(int x, int z) const
+	{
+		return (x & _mask) + (z & _mask) * _dimension;
+	}
+
+	int _dimension;
+	int _mask;
+	int _count;
+	ga_terrain_chunk_slot* _slots;
+};
@@ -0,0 +1,51 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Recycled storage for terrain chunks
+*/
+#include "ga_terrain_chunk_pool.h"
+#include "ga_terrain_chunk.h"
+
+#include <cassert>
+
+ga_terrain_chunk_pool::ga_terrain_chunk_pool(const ga_terrain_field* field, int count)
+{
+	_field = field;
+	_allocated = count;
+
+	_free.reserve(count);
+	for (int i = 0; i < count; i++)
+	{
+		_free.push_back(new ga_terrain_chunk(field, 0, 0));
+	}
+}
+
+ga_terrain_chunk_pool::~ga_terrain_chunk_pool()
+{
+	assert((int) _free.size() == _allocated);
+
+	for (ga_terrain_chunk* chunk : _free)
+	{
+		delete chunk;
+	}
+}
+
+ga_terrain_chunk* ga_terrain_chunk_pool::alloc(int x, int z)
+{
+	if (_free.empty())
+	{
+		_allocated++;
+		return new ga_terrain_chunk(_field, x, z);
+	}
+
+	ga_terrain_chunk* chunk = _free.back();
+	_free.pop_back();
+	chunk->reset(x, z);
+	return chunk;
+}
+
+void ga_terrain_chunk_pool::free(ga_terrain_chunk* chunk)
+{
+	_free.push_back(chunk);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Recycled storage for terrain chunks
+*/
+
+#include <vector>
+
+/*
+** Free list of chunks whose heightmap, bounds and mesh storage is kept for
+** the next chunk to use it. Every chunk of a field is the same size, set by
+** its detail, so a pool is a single size class: once it has grown to the
+** most chunks ever resident, streaming stops allocating.
+** Not thread safe; chunks are allocated and freed by the streamer.
+*/
+class ga_terrain_chunk_pool
+{
+public:
+	/*
+	** Create the pool with count chunks ready to hand out.
+	*/
+	ga_terrain_chunk_pool(const class ga_terrain_field* field, int count);
+	~ga_terrain_chunk_pool();
+
+	// a chunk at (x, z) ready to generate, new only if none are free
+	class ga_terrain_chunk* alloc(int x, int z);
+	void free(class ga_terrain_chunk* chunk);
+
+	// chunks waiting to be reused, such as to free resources they hold
+	const std::vector<class ga_terrain_chunk*>& get_free() const { return _free; }
+
+	// chunks created over the pool's life, free or not
+	int get_allocated() const { return _allocated; }
+
+private:
+	const class ga_terrain_field* _field;
+	std::vector<class ga_terrain_chunk*> _free;
+	int _allocated;
+};
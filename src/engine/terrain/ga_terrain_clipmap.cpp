@@ -0,0 +1,241 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Geometry clipmap terrain
+*/
+#include "ga_terrain_clipmap.h"
+#include "ga_terrain_field.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+
+ga_terrain_clipmap::ga_terrain_clipmap(const ga_terrain_field* field, int levels, int detail)
+{
+	// rings need an even half width so the inner ring lands on even samples,
+	// and have to stay addressable with 16-bit indices
+	assert(levels >= 1);
+	assert(detail >= 2 && detail <= 7);
+
+	const ga_terrain_params& params = field->get_params();
+
+	_field = field;
+	_size = (1 << detail) + 1;
+	_height = params._height;
+
+	_levels.resize(levels);
+	float spacing = params._width / (float) (params._size - 1);
+	for (ga_terrain_clipmap_level& level : _levels)
+	{
+		level._spacing = spacing;
+		level._origin_x = 0;
+		level._origin_z = 0;
+		level._valid = false;
+		level._samples.resize(_size * _size);
+		level._dirty = true;
+
+		spacing *= 2.0f;
+	}
+}
+
+int ga_terrain_clipmap::update(float x, float z)
+{
+	int half = (_size - 1) / 2;
+	int generated = 0;
+
+	for (int l = 0; l < (int) _levels.size(); l++)
+	{
+		ga_terrain_clipmap_level& level = _levels[l];
+
+		// snap to every other sample so the next ring out stays aligned
+		int new_x = (int) std::floor(x / (2.0f * level._spacing)) * 2 - half;
+		int new_z = (int) std::floor(z / (2.0f * level._spacing)) * 2 - half;
+
+		int old_x = level._origin_x;
+		int old_z = level._origin_z;
+		if (level._valid && new_x == old_x && new_z == old_z)
+		{
+			continue;
+		}
+
+		if (!level._valid || std::abs(new_x - old_x) >= _size || std::abs(new_z - old_z) >= _size)
+		{
+			generated += generate(level, new_x, new_x + _size, new_z, new_z + _size);
+		}
+		else
+		{
+			// columns that scrolled in, over the full new height of the window
+			if (new_x > old_x)
+			{
+				generated += generate(level, old_x + _size, new_x + _size, new_z, new_z + _size);
+			}
+			else if (new_x < old_x)
+			{
+				generated += generate(level, new_x, old_x, new_z, new_z + _size);
+			}
+
+			// then rows that scrolled in, over the columns that were kept
+			int kept_x0 = std::max(old_x, new_x);
+			int kept_x1 = std::min(old_x, new_x) + _size;
+			if (new_z > old_z)
+			{
+				generated += generate(level, kept_x0, kept_x1, old_z + _size, new_z + _size);
+			}
+			else if (new_z < old_z)
+			{
+				generated += generate(level, kept_x0, kept_x1, new_z, old_z);
+			}
+		}
+
+		level._origin_x = new_x;
+		level._origin_z = new_z;
+		level._valid = true;
+		level._dirty = true;
+
+		// the next ring's hole follows this one
+		if (l + 1 < (int) _levels.size())
+		{
+			_levels[l + 1]._dirty = true;
+		}
+	}
+
+	return generated;
+}
+
+const std::vector<ga_vec3f>& ga_terrain_clipmap::get_vertices(int level)
+{
+	if (_levels[level]._dirty)
+	{
+		build_mesh(level);
+	}
+	return _levels[level]._vertices;
+}
+
+const std::vector<uint16_t>& ga_terrain_clipmap::get_indices(int level)
+{
+	if (_levels[level]._dirty)
+	{
+		build_mesh(level);
+	}
+	return _levels[level]._indices;
+}
+
+int ga_terrain_clipmap::wrap(int grid) const
+{
+	int wrapped = grid % _size;
+	return wrapped < 0 ? wrapped + _size : wrapped;
+}
+
+int ga_terrain_clipmap::generate(ga_terrain_clipmap_level& level, int x0, int x1, int z0, int z1)
+{
+	int count = (x1 - x0) * (z1 - z0);
+	if (count <= 0)
+	{
+		return 0;
+	}
+
+	_batch_x.resize(count);
+	_batch_z.resize(count);
+	_batch_samples.resize(count);
+
+	int i = 0;
+	for (int gz = z0; gz < z1; gz++)
+	{
+		for (int gx = x0; gx < x1; gx++)
+		{
+			_batch_x[i] = gx * level._spacing;
+			_batch_z[i] = gz * level._spacing;
+			i++;
+		}
+	}
+
+	_field->get_samples(&_batch_x[0], &_batch_z[0], &_batch_samples[0], count);
+
+	// write over whatever scrolled out of the window in the same slots
+	i = 0;
+	for (int gz = z0; gz < z1; gz++)
+	{
+		for (int gx = x0; gx < x1; gx++)
+		{
+			level._samples[wrap(gx) + _size * wrap(gz)] = _batch_samples[i++];
+		}
+	}
+
+	return count;
+}
+
+void ga_terrain_clipmap::build_mesh(int index)
+{
+	ga_terrain_clipmap_level& level = _levels[index];
+	level._dirty = false;
+
+	int n = _size;
+	int half = (n - 1) / 2;
+	bool stitch = index + 1 < (int) _levels.size();
+
+	auto sample = [&](int gx, int gz)
+	{
+		return level._samples[wrap(gx) + n * wrap(gz)];
+	};
+
+	level._vertices.resize(n * n);
+	for (int j = 0; j < n; j++)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			int gx = level._origin_x + i;
+			int gz = level._origin_z + j;
+			float s = sample(gx, gz);
+
+			// odd samples on the outer edge fall halfway along an edge of the
+			// coarser ring, so flatten them onto it to close the crack
+			if (stitch && (j == 0 || j == n - 1) && (gx & 1))
+			{
+				s = (sample(gx - 1, gz) + sample(gx + 1, gz)) * 0.5f;
+			}
+			else if (stitch && (i == 0 || i == n - 1) && (gz & 1))
+			{
+				s = (sample(gx, gz - 1) + sample(gx, gz + 1)) * 0.5f;
+			}
+
+			level._vertices[i + n * j] = {
+				gx * level._spacing,
+				s * _height - _height / 2.0f,
+				gz * level._spacing
+			};
+		}
+	}
+
+	// the finer ring covers half of this one's width; leave a hole for it
+	int hole_x0 = n, hole_x1 = n, hole_z0 = n, hole_z1 = n;
+	if (index > 0)
+	{
+		const ga_terrain_clipmap_level& inner = _levels[index - 1];
+		hole_x0 = inner._origin_x / 2 - level._origin_x;
+		hole_z0 = inner._origin_z / 2 - level._origin_z;
+		hole_x1 = hole_x0 + half;
+		hole_z1 = hole_z0 + half;
+	}
+
+	level._indices.clear();
+	for (int j = 0; j < n - 1; j++)
+	{
+		for (int i = 0; i < n - 1; i++)
+		{
+			if (i >= hole_x0 && i < hole_x1 && j >= hole_z0 && j < hole_z1)
+			{
+				continue;
+			}
+
+			// same winding and diagonal as a chunk's quads
+			level._indices.push_back(i + n * j);
+			level._indices.push_back(i + n * (j + 1));
+			level._indices.push_back(i + 1 + n * (j + 1));
+			level._indices.push_back(i + 1 + n * (j + 1));
+			level._indices.push_back(i + 1 + n * j);
+			level._indices.push_back(i + n * j);
+		}
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Geometry clipmap terrain
+*/
+
+#include "math/ga_vec3f.h"
+
+#include <cstdint>
+#include <vector>
+
+/*
+** One ring of the clipmap: a size * size window of heights at a fixed
+** spacing, stored toroidally so moving the window only rewrites the rows
+** and columns that scroll into view.
+*/
+struct ga_terrain_clipmap_level
+{
+	float _spacing;
+
+	// grid coordinates of the window's first sample; world = grid * spacing
+	int _origin_x;
+	int _origin_z;
+	bool _valid;
+
+	// raw field samples, indexed by grid coordinates wrapped to the window
+	std::vector<float> _samples;
+
+	// mesh rebuilt whenever the window moves
+	bool _dirty;
+	std::vector<ga_vec3f> _vertices;
+	std::vector<uint16_t> _indices;
+};
+
+/*
+** Nested rings of height grids centered on the camera, each twice the
+** spacing of the one inside it. An alternative to streaming whole chunks:
+** the work per frame is proportional to how far the camera moved, not to
+** the chunk size.
+** After Losasso and Hoppe, "Geometry Clipmaps".
+*/
+class ga_terrain_clipmap
+{
+public:
+	/*
+	** Rings are (2^detail + 1)^2 samples. The finest ring uses the chunk
+	** sample spacing, so both modes draw the same lattice up close.
+	*/
+	ga_terrain_clipmap(const class ga_terrain_field* field, int levels, int detail);
+
+	/*
+	** Recenter every ring on the camera and generate what scrolled into view.
+	** Returns the number of samples generated.
+	*/
+	int update(float x, float z);
+
+	int get_level_count() const { return (int) _levels.size(); }
+
+	/*
+	** Mesh of a ring with the area covered by the ring inside it cut out.
+	** Vertices are in world space.
+	*/
+	const std::vector<ga_vec3f>& get_vertices(int level);
+	const std::vector<uint16_t>& get_indices(int level);
+
+private:
+	const class ga_terrain_field* _field;
+	int _size;
+	int _height;
+	std::vector<ga_terrain_clipmap_level> _levels;
+
+	// scratch space for batching samples through the field
+	std::vector<float> _batch_x;
+	std::vector<float> _batch_z;
+	std::vector<float> _batch_samples;
+
+	int wrap(int grid) const;
+
+	// generate samples for grid columns [x0, x1) and rows [z0, z1)
+	int generate(ga_terrain_clipmap_level& level, int x0, int x1, int z0, int z1);
+
+	void build_mesh(int index);
+};
@@ -0,0 +1,361 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Compression of chunk heightmaps
+*/
+#include "ga_terrain_codec.h"
+
+#include "framework/ga_compiler_defines.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#if defined(GA_MSVC)
+#include <intrin.h>
+#endif
+
+// values past this many ones of unary quotient are written out in full
+static const int k_rice_escape = 24;
+
+struct codec_header_t
+{
+	int32_t _size;
+	int32_t _bits;
+	float _min;
+	float _max;
+};
+
+/*
+** Bits appended to a byte vector, least significant first.
+*/
+struct bit_writer_t
+{
+	std::vector<uint8_t>* _data;
+	uint64_t _buffer;
+	int _count;
+};
+
+struct bit_reader_t
+{
+	const uint8_t* _data;
+	const uint8_t* _end;
+	uint64_t _buffer;
+	int _count;
+};
+
+static void _write_bits(bit_writer_t* writer, uint32_t value, int bits);
+static void _flush_bits(bit_writer_t* writer);
+static void _refill_bits(bit_reader_t* reader);
+static int _count_trailing_ones(uint64_t bits);
+static uint32_t _read_bits(bit_reader_t* reader, int bits);
+static void _write_rice(bit_writer_t* writer, uint32_t value, int k);
+static uint32_t _read_rice(bit_reader_t* reader, int k);
+static int _choose_rice_k(const uint32_t* values, int count);
+static void _edge_indices(int size, std::vector<int>& indices);
+
+void ga_terrain_codec::encode(const float* samples, int size, int bits, std::vector<uint8_t>& data)
+{
+	assert(bits >= k_min_bits && bits <= k_max_bits);
+
+	codec_header_t header;
+	header._size = size;
+	header._bits = bits;
+	header._min = *std::min_element(samples, samples + size * size);
+	header._max = *std::max_element(samples, samples + size * size);
+
+	// about the most a smooth heightmap needs, so writing rarely reallocates
+	data.clear();
+	data.reserve(sizeof(header) + size * size * bits / 8);
+	data.resize(sizeof(header));
+	memcpy(&data[0], &header, sizeof(header));
+
+	// edges verbatim
+	std::vector<int> edges;
+	_edge_indices(size, edges);
+	size_t offset = data.size();
+	data.resize(offset + edges.size() * sizeof(float));
+	for (size_t e = 0; e < edges.size(); e++)
+	{
+		memcpy(&data[offset + e * sizeof(float)], &samples[edges[e]], sizeof(float));
+	}
+
+	float levels = (float) ((1 << bits) - 1);
+	float range = header._max - header._min;
+	float inv_step = range > 0.0f ? levels / range : 0.0f;
+
+	// quantize, then code each row's residuals from the previous row
+	std::vector<int32_t> previous(size), current(size);
+	std::vector<uint32_t> residuals(size);
+	bit_writer_t writer = { &data, 0, 0 };
+
+	for (int j = 0; j < size; j++)
+	{
+		for (int i = 0; i < size; i++)
+		{
+			current[i] = (int32_t) ((samples[j * size + i] - header._min) * inv_step + 0.5f);
+
+			// planar prediction from the left, above and above left
+			int32_t prediction;
+			if (j == 0)
+			{
+				prediction = i > 0 ? current[i - 1] : 0;
+			}
+			else if (i == 0)
+			{
+				prediction = previous[i];
+			}
+			else
+			{
+				prediction = current[i - 1] + previous[i] - previous[i - 1];
+			}
+
+			// zigzag, so small residuals of either sign are small codes
+			int32_t residual = current[i] - prediction;
+			residuals[i] = ((uint32_t) residual << 1) ^ (uint32_t) (residual >> 31);
+		}
+
+		int k = _choose_rice_k(&residuals[0], size);
+		_write_bits(&writer, k, 5);
+		for (int i = 0; i < size; i++)
+		{
+			_write_rice(&writer, residuals[i], k);
+		}
+
+		previous.swap(current);
+	}
+
+	_flush_bits(&writer);
+}
+
+bool ga_terrain_codec::decode(const std::vector<uint8_t>& data, float* samples, int size)
+{
+	codec_header_t header;
+	if (data.size() < sizeof(header))
+	{
+		return false;
+	}
+	memcpy(&header, &data[0], sizeof(header));
+	if (header._size != size || header._bits < k_min_bits || header._bits > k_max_bits)
+	{
+		return false;
+	}
+
+	std::vector<int> edges;
+	_edge_indices(size, edges);
+	size_t offset = sizeof(header);
+	size_t residual_offset = offset + edges.size() * sizeof(float);
+	if (data.size() < residual_offset)
+	{
+		return false;
+	}
+
+	float levels = (float) ((1 << header._bits) - 1);
+	float step = (header._max - header._min) / levels;
+
+	std::vector<int32_t> previous(size), current(size);
+	bit_reader_t reader = { &data[0] + residual_offset, &data[0] + data.size(), 0, 0 };
+
+	for (int j = 0; j < size; j++)
+	{
+		int k = (int) _read_bits(&reader, 5);
+		for (int i = 0; i < size; i++)
+		{
+			uint32_t code = _read_rice(&reader, k);
+			int32_t residual = (int32_t) (code >> 1) ^ -(int32_t) (code & 1);
+
+			int32_t prediction;
+			if (j == 0)
+			{
+				prediction = i > 0 ? current[i - 1] : 0;
+			}
+			else if (i == 0)
+			{
+				prediction = previous[i];
+			}
+			else
+			{
+				prediction = current[i - 1] + previous[i] - previous[i - 1];
+			}
+
+			current[i] = prediction + residual;
+			samples[j * size + i] = header._min + (float) current[i] * step;
+		}
+
+		previous.swap(current);
+	}
+
+	for (size_t e = 0; e < edges.size(); e++)
+	{
+		memcpy(&samples[edges[e]], &data[offset + e * sizeof(float)], sizeof(float));
+	}
+
+	return true;
+}
+
+static void _write_bits(bit_writer_t* writer, uint32_t value, int bits)
+{
+	writer->_buffer |= (uint64_t) value << writer->_count;
+	writer->_count += bits;
+	if (writer->_count >= 32)
+	{
+		uint32_t word = (uint32_t) writer->_buffer;
+		size_t offset = writer->_data->size();
+		writer->_data->resize(offset + sizeof(word));
+		memcpy(&(*writer->_data)[offset], &word, sizeof(word));
+		writer->_buffer >>= 32;
+		writer->_count -= 32;
+	}
+}
+
+static void _flush_bits(bit_writer_t* writer)
+{
+	while (writer->_count > 0)
+	{
+		writer->_data->push_back((uint8_t) writer->_buffer);
+		writer->_buffer >>= 8;
+		writer->_count -= 8;
+	}
+	writer->_buffer = 0;
+	writer->_count = 0;
+}
+
+static void _refill_bits(bit_reader_t* reader)
+{
+	// a whole word at once away from the end; bits are least significant
+	// first, which is the byte order of the targets the engine builds for
+	if (reader->_end - reader->_data >= 8)
+	{
+		uint64_t word;
+		memcpy(&word, reader->_data, sizeof(word));
+		reader->_buffer |= word << reader->_count;
+		int bytes = (63 - reader->_count) >> 3;
+		reader->_data += bytes;
+		reader->_count += bytes * 8;
+		return;
+	}
+
+	// past the end reads as zeros; the row counts stop decoding first
+	while (reader->_count <= 56)
+	{
+		uint64_t byte = reader->_data < reader->_end ? *reader->_data++ : 0;
+		reader->_buffer |= byte << reader->_count;
+		reader->_count += 8;
+	}
+}
+
+static uint32_t _read_bits(bit_reader_t* reader, int bits)
+{
+	if (bits == 0)
+	{
+		return 0;
+	}
+	if (reader->_count < bits)
+	{
+		_refill_bits(reader);
+	}
+	uint32_t value = (uint32_t) (reader->_buffer & ((1ull << bits) - 1));
+	reader->_buffer >>= bits;
+	reader->_count -= bits;
+	return value;
+}
+
+// quotient in unary, terminated by a zero, then the low k bits
+static void _write_rice(bit_writer_t* writer, uint32_t value, int k)
+{
+	uint32_t quotient = value >> k;
+	if (quotient >= (uint32_t) k_rice_escape)
+	{
+		_write_bits(writer, (1u << k_rice_escape) - 1, k_rice_escape);
+		_write_bits(writer, value & 0xffff, 16);
+		_write_bits(writer, value >> 16, 16);
+		return;
+	}
+
+	_write_bits(writer, (1u << quotient) - 1, (int) quotient + 1);
+	_write_bits(writer, value & ((1u << k) - 1), k);
+}
+
+static uint32_t _read_rice(bit_reader_t* reader, int k)
+{
+	// enough buffered for any code short of an escape
+	if (reader->_count <= 56)
+	{
+		_refill_bits(reader);
+	}
+
+	int quotient = std::min(_count_trailing_ones(reader->_buffer), k_rice_escape);
+
+	if (quotient == k_rice_escape)
+	{
+		reader->_buffer >>= k_rice_escape;
+		reader->_count -= k_rice_escape;
+		uint32_t low = _read_bits(reader, 16);
+		return low | (_read_bits(reader, 16) << 16);
+	}
+
+	reader->_buffer >>= quotient + 1;
+	uint32_t remainder = (uint32_t) (reader->_buffer & ((1ull << k) - 1));
+	reader->_buffer >>= k;
+	reader->_count -= quotient + 1 + k;
+	return ((uint32_t) quotient << k) | remainder;
+}
+
+static int _count_trailing_ones(uint64_t bits)
+{
+	uint64_t zeros = ~bits;
+	if (zeros == 0)
+	{
+		return 64;
+	}
+#if defined(GA_MSVC) && defined(GA_64_BIT)
+	unsigned long index;
+	_BitScanForward64(&index, zeros);
+	return (int) index;
+#elif defined(GA_MSVC)
+	unsigned long index;
+	if (_BitScanForward(&index, (unsigned long) zeros))
+	{
+		return (int) index;
+	}
+	_BitScanForward(&index, (unsigned long) (zeros >> 32));
+	return (int) index + 32;
+#else
+	return __builtin_ctzll(zeros);
+#endif
+}
+
+// the parameter that about minimizes the row's coded length
+static int _choose_rice_k(const uint32_t* values, int count)
+{
+	uint64_t sum = 0;
+	for (int i = 0; i < count; i++)
+	{
+		sum += values[i];
+	}
+
+	int k = 0;
+	while (k < 24 && ((uint64_t) count << (k + 1)) <= sum)
+	{
+		k++;
+	}
+	return k;
+}
+
+// the border of a size x size grid, each sample once
+static void _edge_indices(int size, std::vector<int>& indices)
+{
+	indices.clear();
+	for (int i = 0; i < size; i++)
+	{
+		indices.push_back(i);
+		indices.push_back((size - 1) * size + i);
+	}
+	for (int j = 1; j < size - 1; j++)
+	{
+		indices.push_back(j * size);
+		indices.push_back(j * size + size - 1);
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Compression of chunk heightmaps
+*/
+
+#include <cstdint>
+#include <vector>
+
+/*
+** Compact encoding of a chunk's size x size heightmap, for keeping chunks
+** that have left the view without keeping their floats.
+** Samples are quantized between the chunk's lowest and highest, each is
+** predicted from the three decoded neighbors before it, and the residuals
+** are Rice coded a row at a time. Samples along the four edges are kept
+** exactly, so a decoded chunk still meets freshly generated neighbors.
+*/
+class ga_terrain_codec
+{
+public:
+	// quantization precision allowed, in bits per sample
+	static const int k_min_bits = 8;
+	static const int k_max_bits = 24;
+
+	/*
+	** Replace data with the encoded heightmap, quantized to bits.
+	*/
+	static void encode(const float* samples, int size, int bits, std::vector<uint8_t>& data);
+
+	/*
+	** Decode into samples, which must hold size x size. Returns false if the
+	** data wasn't encoded from a heightmap of that size.
+	*/
+	static bool decode(const std::vector<uint8_t>& data, float* samples, int size);
+};
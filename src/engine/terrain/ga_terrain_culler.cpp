@@ -0,0 +1,36 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** View frustum culling of terrain chunks
+*/
+#include "ga_terrain_culler.h"
+
+void ga_terrain_culler::set_view_projection(const ga_mat4f& view_proj)
+{
+	_frustum.make_from_view_projection(view_proj);
+}
+
+void ga_terrain_culler::clear()
+{
+	// keep the capacity around so steady state culling doesn't allocate
+	_boxes.clear();
+	_results.clear();
+	_visible_count = 0;
+}
+
+void ga_terrain_culler::add_box(const ga_vec3f& min, const ga_vec3f& max)
+{
+	_boxes.push_back({ min, max });
+}
+
+void ga_terrain_culler::cull()
+{
+	_results.resize(_boxes.size());
+	_visible_count = _results.empty() ? 0 : _frustum.test_boxes(_boxes, &_results[0]);
+}
+
+bool ga_terrain_culler::is_box_visible(const ga_vec3f& min, const ga_vec3f& max) const
+{
+	return _frustum.test_box({ min, max }) != k_frustum_outside;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** View frustum culling of terrain chunks
+*/
+
+#include "math/ga_frustum.h"
+#include "math/ga_mat4f.h"
+#include "math/ga_vec3f.h"
+
+#include <cstdint>
+#include <vector>
+
+/*
+** Batched view frustum test for chunk bounding boxes.
+** Boxes are collected through the frame and tested together, several at a
+** time, by ga_frustum.
+*/
+class ga_terrain_culler
+{
+public:
+	/*
+	** Extract the six frustum planes from a view-projection matrix.
+	*/
+	void set_view_projection(const ga_mat4f& view_proj);
+
+	void clear();
+	void add_box(const ga_vec3f& min, const ga_vec3f& max);
+
+	/*
+	** Test every box added since the last clear against the frustum.
+	*/
+	void cull();
+
+	/*
+	** Test a single box right away, without adding it to the batch.
+	*/
+	bool is_box_visible(const ga_vec3f& min, const ga_vec3f& max) const;
+
+	int get_count() const { return _boxes.size(); }
+	int get_visible_count() const { return _visible_count; }
+	bool is_visible(int index) const { return _results[index] != k_frustum_outside; }
+
+private:
+	ga_frustum _frustum;
+	ga_aabb_soa _boxes;
+
+	// a ga_frustum_test per box
+	std::vector<uint8_t> _results;
+	int _visible_count;
+};
@@ -0,0 +1,260 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Sparse runtime edits on top of the procedural terrain
+*/
+#include "ga_terrain_edit_layer.h"
+#include "ga_terrain_chunk.h"
+#include "ga_terrain_chunk_grid.h"
+#include "ga_terrain_field.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+
+static int _floor_div(int a, int b);
+
+ga_terrain_edit_layer::ga_terrain_edit_layer(const ga_terrain_field* field)
+{
+	_field = field;
+
+	const ga_terrain_params& params = field->get_params();
+	_size = params._size;
+	_cell = params._width / (float) (params._size - 1);
+	_height = (float) params._height;
+}
+
+void ga_terrain_edit_layer::apply(const ga_terrain_brush& brush, const ga_terrain_chunk_grid* loaded,
+	std::set<std::pair<int, int> >& touched)
+{
+	// the samples under the brush, and one more all around for smoothing
+	int x0 = (int) std::floor((brush._x - brush._radius) / _cell) - 1;
+	int z0 = (int) std::floor((brush._z - brush._radius) / _cell) - 1;
+	int x1 = (int) std::ceil((brush._x + brush._radius) / _cell) + 1;
+	int z1 = (int) std::ceil((brush._z + brush._radius) / _cell) + 1;
+	int width = x1 - x0 + 1;
+	int depth = z1 - z0 + 1;
+
+	_brush_x.resize(width * depth);
+	_brush_z.resize(width * depth);
+	_brush_heights.resize(width * depth);
+	for (int j = 0; j < depth; j++)
+	{
+		for (int i = 0; i < width; i++)
+		{
+			_brush_x[j * width + i] = (float) (x0 + i) * _cell;
+			_brush_z[j * width + i] = (float) (z0 + j) * _cell;
+		}
+	}
+
+	// heights as they are now, edits included; erosion only exists in the
+	// chunks it ran on, so take those from a refined chunk wherever one is loaded
+	_field->get_samples(&_brush_x[0], &_brush_z[0], &_brush_heights[0], width * depth);
+	int cells = _size - 1;
+	int half = cells / 2;
+	for (int j = 0; j < depth; j++)
+	{
+		for (int i = 0; i < width; i++)
+		{
+			int x = x0 + i;
+			int z = z0 + j;
+			if (loaded != NULL)
+			{
+				int cx = _floor_div(x + half, cells);
+				int cz = _floor_div(z + half, cells);
+				const ga_terrain_chunk* chunk = loaded->find(cx, cz);
+				if (chunk != NULL && chunk->is_refined())
+				{
+					int ci = x - cx * cells + half;
+					int cj = z - cz * cells + half;
+					_brush_heights[j * width + i] = chunk->get_base_heights()[cj * _size + ci];
+				}
+			}
+			_brush_heights[j * width + i] += get_offset(x, z);
+		}
+	}
+
+	// heightmap units, which span the field's full height
+	float amount = brush._strength / _height;
+	float blend = std::min(std::max(brush._strength, 0.0f), 1.0f);
+	float target = brush._height / _height + 0.5f;
+
+	float inv_radius_sq = 1.0f / (brush._radius * brush._radius);
+	for (int j = 1; j < depth - 1; j++)
+	{
+		for (int i = 1; i < width - 1; i++)
+		{
+			float dx = _brush_x[j * width + i] - brush._x;
+			float dz = _brush_z[j * width + i] - brush._z;
+			float d = (dx * dx + dz * dz) * inv_radius_sq;
+			if (d >= 1.0f)
+			{
+				continue;
+			}
+
+			// smooth falloff, flat at the center and at the rim
+			float falloff = (1.0f - d) * (1.0f - d);
+			const float* h = &_brush_heights[j * width + i];
+
+			float change = 0.0f;
+			switch (brush._op)
+			{
+			case k_brush_raise:
+				change = amount * falloff;
+				break;
+			case k_brush_lower:
+				change = -amount * falloff;
+				break;
+			case k_brush_smooth:
+				change = blend * falloff * (0.25f * (h[-1] + h[1] + h[-width] + h[width]) - h[0]);
+				break;
+			case k_brush_flatten:
+				change = blend * falloff * (target - h[0]);
+				break;
+			}
+
+			if (change != 0.0f)
+			{
+				set_offset(x0 + i, z0 + j, get_offset(x0 + i, z0 + j) + change, touched);
+			}
+		}
+	}
+}
+
+const std::vector<float>* ga_terrain_edit_layer::find(int x, int z) const
+{
+	auto found = _chunks.find(std::make_pair(x, z));
+	return found != _chunks.end() ? &found->second : NULL;
+}
+
+float ga_terrain_edit_layer::sample(float x, float z) const
+{
+	if (_chunks.empty())
+	{
+		return 0.0f;
+	}
+
+	float u = x / _cell;
+	float v = z / _cell;
+	int i = (int) std::floor(u);
+	int j = (int) std::floor(v);
+	float fu = u - (float) i;
+	float fv = v - (float) j;
+
+	float top = get_offset(i, j) + fu * (get_offset(i + 1, j) - get_offset(i, j));
+	float bottom = get_offset(i, j + 1) + fu * (get_offset(i + 1, j + 1) - get_offset(i, j + 1));
+
+	return (top + fv * (bottom - top)) * _height;
+}
+
+bool ga_terrain_edit_layer::save(const char* path) const
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cerr << "Error saving terrain edits: can't open '" << path << "'" << std::endl;
+		return false;
+	}
+
+	// chunk size and count, then each chunk's coordinates and offsets
+	int32_t header[2] = { _size, (int32_t) _chunks.size() };
+	file.write((const char*) header, sizeof(header));
+	for (const auto& chunk : _chunks)
+	{
+		int32_t key[2] = { chunk.first.first, chunk.first.second };
+		file.write((const char*) key, sizeof(key));
+		file.write((const char*) &chunk.second[0], chunk.second.size() * sizeof(float));
+	}
+
+	return file.good();
+}
+
+bool ga_terrain_edit_layer::load(const char* path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	int32_t header[2];
+	file.read((char*) header, sizeof(header));
+	if (!file || header[0] != _size || header[1] < 0)
+	{
+		std::cerr << "Error loading terrain edits: '" << path << "' isn't for chunks of this size" << std::endl;
+		return false;
+	}
+
+	std::map<std::pair<int, int>, std::vector<float> > chunks;
+	for (int c = 0; c < header[1]; c++)
+	{
+		int32_t key[2];
+		file.read((char*) key, sizeof(key));
+
+		std::vector<float>& offsets = chunks[std::make_pair(key[0], key[1])];
+		offsets.resize(_size * _size);
+		file.read((char*) &offsets[0], offsets.size() * sizeof(float));
+		if (!file)
+		{
+			std::cerr << "Error loading terrain edits: '" << path << "' is truncated" << std::endl;
+			return false;
+		}
+	}
+
+	_chunks.swap(chunks);
+	return true;
+}
+
+float ga_terrain_edit_layer::get_offset(int x, int z) const
+{
+	// chunk (cx, cz) holds samples cx * (size - 1) +- (size - 1) / 2; shared
+	// edges hold the same offset in both chunks, so either will do
+	int cells = _size - 1;
+	int half = cells / 2;
+	int cx = _floor_div(x + half, cells);
+	int cz = _floor_div(z + half, cells);
+
+	auto found = _chunks.find(std::make_pair(cx, cz));
+	if (found == _chunks.end())
+	{
+		return 0.0f;
+	}
+
+	int i = x - cx * cells + half;
+	int j = z - cz * cells + half;
+	return found->second[j * _size + i];
+}
+
+void ga_terrain_edit_layer::set_offset(int x, int z, float offset, std::set<std::pair<int, int> >& touched)
+{
+	int cells = _size - 1;
+	int half = cells / 2;
+
+	// a sample on an edge or corner belongs to two or four chunks
+	for (int cz = -_floor_div(half - z, cells); cz <= _floor_div(z + half, cells); cz++)
+	{
+		for (int cx = -_floor_div(half - x, cells); cx <= _floor_div(x + half, cells); cx++)
+		{
+			std::pair<int, int> key = std::make_pair(cx, cz);
+			std::vector<float>& offsets = _chunks[key];
+			if (offsets.empty())
+			{
+				offsets.assign(_size * _size, 0.0f);
+			}
+
+			int i = x - cx * cells + half;
+			int j = z - cz * cells + half;
+			offsets[j * _size + i] = offset;
+			touched.insert(key);
+		}
+	}
+}
+
+static int _floor_div(int a, int b)
+{
+	int q = a / b;
+	return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Sparse runtime edits on top of the procedural terrain
+*/
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+/*
+** Ways a brush can change the terrain under it.
+*/
+enum ga_terrain_brush_op
+{
+	k_brush_raise,
+	k_brush_lower,
+	k_brush_smooth,
+	k_brush_flatten,
+};
+
+/*
+** A circular brush stroke, strongest at its center and fading to nothing at
+** its radius.
+*/
+struct ga_terrain_brush
+{
+	ga_terrain_brush_op _op;
+
+	// world space center and radius
+	float _x;
+	float _z;
+	float _radius;
+
+	// world units raised or lowered at the center; smooth and flatten move
+	// that fraction of the way to the neighbors' average or to height
+	float _strength;
+	float _height;
+};
+
+/*
+** Height offsets added to the field's samples, kept only for chunks that
+** have been edited. Offsets are stored per chunk on the chunk's own sample
+** grid, in heightmap units, and samples on a shared edge are written to
+** every chunk holding them so neighbors stay seamless.
+** Edits outlive the chunks they apply to: a chunk streamed in again gets
+** its offsets back from here.
+** Not thread safe; edits are made and read by the streamer.
+*/
+class ga_terrain_edit_layer
+{
+public:
+	ga_terrain_edit_layer(const class ga_terrain_field* field);
+
+	/*
+	** Apply a brush stroke, adding the coordinates of every chunk holding a
+	** changed sample to touched. A stroke reaching a chunk's edge touches
+	** the neighbor across it too. Smooth and flatten work from the eroded
+	** heights of refined chunks in loaded, if given, and the field's
+	** elsewhere.
+	*/
+	void apply(const ga_terrain_brush& brush, const class ga_terrain_chunk_grid* loaded,
+		std::set<std::pair<int, int> >& touched);
+
+	// size x size offsets of chunk (x, z), or null if it was never edited
+	const std::vector<float>* find(int x, int z) const;
+
+	// world units the terrain at world (x, z) has been moved, bilinearly sampled
+	float sample(float x, float z) const;
+
+	int get_chunk_count() const { return (int) _chunks.size(); }
+
+	/*
+	** Write every edited chunk's offsets to path, or read them back,
+	** replacing any edits made so far. Both return false, leaving the layer
+	** as it was, if the file can't be used.
+	*/
+	bool save(const char* path) const;
+	bool load(const char* path);
+
+private:
+	// offset of the sample at (x, z) on the grid shared by every chunk, which
+	// puts sample (x, z) at world (x * cell, z * cell)
+	float get_offset(int x, int z) const;
+	void set_offset(int x, int z, float offset, std::set<std::pair<int, int> >& touched);
+
+	const class ga_terrain_field* _field;
+	int _size;
+	float _cell;
+	float _height;
+
+	std::map<std::pair<int, int>, std::vector<float> > _chunks;
+
+	// samples under the brush, kept between strokes
+	std::vector<float> _brush_x;
+	std::vector<float> _brush_z;
+	std::vector<float> _brush_heights;
+};
@@ -0,0 +1,418 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Hydraulic and thermal erosion of chunk heightmaps
+*/
+#include "ga_terrain_erosion.h"
+
+#include "framework/ga_compiler_defines.h"
+#include "framework/ga_cpu.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#if defined(GA_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(GA_AVX2)
+#include <immintrin.h>
+#endif
+
+// droplet behavior; droplets move a sample spacing a step
+static const int k_max_steps = 48;
+static const float k_inertia = 0.05f;
+static const float k_capacity = 4.0f;
+static const float k_min_capacity = 0.01f;
+static const float k_erosion = 0.3f;
+static const float k_deposition = 0.3f;
+static const float k_evaporation = 0.02f;
+static const float k_gravity = 4.0f;
+
+// erosion spreads over this many samples around the droplet, so droplets
+// following each other down a slope cut a channel rather than a row of pits
+static const int k_brush_radius = 2;
+
+// fraction of the excess over the talus moved to each neighbor an
+// iteration; four neighbors at this rate can't overshoot
+static const float k_thermal_rate = 0.125f;
+
+static uint32_t _hash(uint32_t seed, int x, int z);
+static float _random(uint32_t* state);
+static float _sample(const ga_terrain_erosion_tile& tile, float x, float z, float* grad_x, float* grad_z);
+static void _deposit(const ga_terrain_erosion_tile& tile, float x, float z, float amount);
+static void _erode(const ga_terrain_erosion_tile& tile, float x, float z, float amount);
+static float _fade(const ga_terrain_erosion_tile& tile, int i, int j);
+
+// one thermal iteration over the interior, reading src and writing dst
+typedef void (*relax_rows_t)(const float* src, float* dst, int size, float talus);
+static relax_rows_t _bind_relax_rows();
+static void _relax_rows(const float* src, float* dst, int size, float talus);
+#if defined(GA_SSE2)
+static void _relax_rows_sse2(const float* src, float* dst, int size, float talus);
+#endif
+#if defined(GA_AVX2)
+GA_TARGET_AVX2 static void _relax_rows_avx2(const float* src, float* dst, int size, float talus);
+#endif
+
+void ga_terrain_erosion::build_tiles(float* heights, int size, int chunk_x, int chunk_z, int seed, float droplets,
+	int tile_size, float height_scale, std::vector<ga_terrain_erosion_tile>& tiles)
+{
+	int cells = size - 1;
+	int per_side = (cells + tile_size - 1) / tile_size;
+
+	// tiles of a pass are a tile apart, so aprons under half a tile never
+	// meet, with a sample to spare for the corners droplets write
+	int apron = tile_size / 4;
+	assert(2 * apron + 1 < tile_size || per_side == 1);
+
+	tiles.clear();
+	for (int pass = 0; pass < k_passes; pass++)
+	{
+		for (int tz = pass / 2; tz < per_side; tz += 2)
+		{
+			for (int tx = pass % 2; tx < per_side; tx += 2)
+			{
+				ga_terrain_erosion_tile tile;
+				tile._heights = heights;
+				tile._size = size;
+
+				tile._x0 = tx * tile_size;
+				tile._z0 = tz * tile_size;
+				tile._x1 = std::min(tile._x0 + tile_size, cells);
+				tile._z1 = std::min(tile._z0 + tile_size, cells);
+				tile._region_x0 = std::max(tile._x0 - apron, 0);
+				tile._region_z0 = std::max(tile._z0 - apron, 0);
+				tile._region_x1 = std::min(tile._x1 + apron, cells);
+				tile._region_z1 = std::min(tile._z1 + apron, cells);
+
+				// seeded by where it is in the world, so a chunk erodes the same
+				// every time it's generated
+				tile._pass = pass;
+				tile._droplets = (int) (droplets * (float) ((tile._x1 - tile._x0) * (tile._z1 - tile._z0)) + 0.5f);
+				tile._seed = _hash((uint32_t) seed, chunk_x * per_side + tx, chunk_z * per_side + tz);
+
+				tile._height_scale = height_scale;
+				tile._fade = std::max(apron, 1);
+
+				tiles.push_back(tile);
+			}
+		}
+	}
+}
+
+void ga_terrain_erosion::erode_tile(const ga_terrain_erosion_tile& tile)
+{
+	uint32_t state = tile._seed;
+
+	// droplets stop once the corners they'd touch leave the region
+	float min_x = (float) tile._region_x0;
+	float min_z = (float) tile._region_z0;
+	float max_x = (float) tile._region_x1;
+	float max_z = (float) tile._region_z1;
+
+	for (int d = 0; d < tile._droplets; d++)
+	{
+		float x = (float) tile._x0 + _random(&state) * (float) (tile._x1 - tile._x0);
+		float z = (float) tile._z0 + _random(&state) * (float) (tile._z1 - tile._z0);
+		float dir_x = 0.0f;
+		float dir_z = 0.0f;
+		float speed = 1.0f;
+		float water = 1.0f;
+		float sediment = 0.0f;
+
+		for (int step = 0; step < k_max_steps; step++)
+		{
+			float grad_x, grad_z;
+			float height = _sample(tile, x, z, &grad_x, &grad_z);
+
+			// keep some of the old heading, turn the rest downhill
+			dir_x = dir_x * k_inertia - grad_x * (1.0f - k_inertia);
+			dir_z = dir_z * k_inertia - grad_z * (1.0f - k_inertia);
+			float length = std::sqrt(dir_x * dir_x + dir_z * dir_z);
+			if (length < 1e-6f)
+			{
+				break;
+			}
+			dir_x /= length;
+			dir_z /= length;
+
+			float next_x = x + dir_x;
+			float next_z = z + dir_z;
+			if (next_x < min_x || next_x >= max_x || next_z < min_z || next_z >= max_z)
+			{
+				break;
+			}
+
+			float unused_x, unused_z;
+			float delta = _sample(tile, next_x, next_z, &unused_x, &unused_z) - height;
+
+			// fast, full droplets going downhill carry the most
+			float capacity = std::max(-delta * speed * water * k_capacity, k_min_capacity);
+			if (sediment > capacity || delta > 0.0f)
+			{
+				// uphill, fill the hollow behind as far as the sediment goes
+				float amount = delta > 0.0f ? std::min(delta, sediment) : (sediment - capacity) * k_deposition;
+				sediment -= amount;
+				_deposit(tile, x, z, amount);
+			}
+			else
+			{
+				// never dig deeper than the drop, or the droplet digs a pit
+				float amount = std::min((capacity - sediment) * k_erosion, -delta);
+				sediment += amount;
+				_erode(tile, x, z, amount);
+			}
+
+			speed = std::sqrt(std::max(speed * speed - delta * k_gravity, 0.0f));
+			water *= 1.0f - k_evaporation;
+			x = next_x;
+			z = next_z;
+		}
+	}
+}
+
+void ga_terrain_erosion::relax(float* heights, float* scratch, int size, int iterations, float talus)
+{
+	static const relax_rows_t relax_rows = _bind_relax_rows();
+
+	// both buffers start with the edges, which no iteration writes
+	memcpy(scratch, heights, size * size * sizeof(float));
+
+	float* src = heights;
+	float* dst = scratch;
+	for (int i = 0; i < iterations; i++)
+	{
+		relax_rows(src, dst, size, talus);
+		std::swap(src, dst);
+	}
+
+	if (src != heights)
+	{
+		memcpy(heights, src, size * size * sizeof(float));
+	}
+}
+
+static uint32_t _hash(uint32_t seed, int x, int z)
+{
+	// murmur3's finalizer over the three, never zero so xorshift can start from it
+	uint32_t h = seed * 0x9e3779b9u ^ (uint32_t) x * 0x85ebca6bu ^ (uint32_t) z * 0xc2b2ae35u;
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h != 0 ? h : 1;
+}
+
+static float _random(uint32_t* state)
+{
+	// xorshift32, top 24 bits to [0, 1)
+	uint32_t s = *state;
+	s ^= s << 13;
+	s ^= s >> 17;
+	s ^= s << 5;
+	*state = s;
+	return (float) (s >> 8) * (1.0f / 16777216.0f);
+}
+
+static float _sample(const ga_terrain_erosion_tile& tile, float x, float z, float* grad_x, float* grad_z)
+{
+	int i = (int) x;
+	int j = (int) z;
+	float fx = x - (float) i;
+	float fz = z - (float) j;
+
+	const float* row = tile._heights + j * tile._size + i;
+	float h00 = row[0] * tile._height_scale;
+	float h10 = row[1] * tile._height_scale;
+	float h01 = row[tile._size] * tile._height_scale;
+	float h11 = row[tile._size + 1] * tile._height_scale;
+
+	*grad_x = (h10 - h00) * (1.0f - fz) + (h11 - h01) * fz;
+	*grad_z = (h01 - h00) * (1.0f - fx) + (h11 - h10) * fx;
+
+	return (h00 * (1.0f - fx) + h10 * fx) * (1.0f - fz) + (h01 * (1.0f - fx) + h11 * fx) * fz;
+}
+
+static void _deposit(const ga_terrain_erosion_tile& tile, float x, float z, float amount)
+{
+	int i = (int) x;
+	int j = (int) z;
+	float fx = x - (float) i;
+	float fz = z - (float) j;
+
+	float weights[4] = { (1.0f - fx) * (1.0f - fz), fx * (1.0f - fz), (1.0f - fx) * fz, fx * fz };
+	for (int c = 0; c < 4; c++)
+	{
+		int ci = i + (c & 1);
+		int cj = j + (c >> 1);
+		tile._heights[cj * tile._size + ci] += amount * weights[c] * _fade(tile, ci, cj) / tile._height_scale;
+	}
+}
+
+static void _erode(const ga_terrain_erosion_tile& tile, float x, float z, float amount)
+{
+	// samples within the brush, weighted by closeness and kept in the region
+	int i0 = std::max((int) std::ceil(x - k_brush_radius), tile._region_x0);
+	int j0 = std::max((int) std::ceil(z - k_brush_radius), tile._region_z0);
+	int i1 = std::min((int) std::floor(x + k_brush_radius), tile._region_x1);
+	int j1 = std::min((int) std::floor(z + k_brush_radius), tile._region_z1);
+
+	float weights[(2 * k_brush_radius + 1) * (2 * k_brush_radius + 1)];
+	float total = 0.0f;
+	int count = 0;
+	for (int j = j0; j <= j1; j++)
+	{
+		for (int i = i0; i <= i1; i++)
+		{
+			float dx = (float) i - x;
+			float dz = (float) j - z;
+			float weight = std::max((float) k_brush_radius - std::sqrt(dx * dx + dz * dz), 0.0f);
+			weights[count++] = weight;
+			total += weight;
+		}
+	}
+
+	if (total <= 0.0f)
+	{
+		return;
+	}
+
+	float scale = amount / (total * tile._height_scale);
+	count = 0;
+	for (int j = j0; j <= j1; j++)
+	{
+		for (int i = i0; i <= i1; i++)
+		{
+			tile._heights[j * tile._size + i] -= weights[count++] * scale * _fade(tile, i, j);
+		}
+	}
+}
+
+static float _fade(const ga_terrain_erosion_tile& tile, int i, int j)
+{
+	// nothing at the edges, full strength fade samples in
+	int cells = tile._size - 1;
+	int edge = std::min(std::min(i, j), std::min(cells - i, cells - j));
+	return edge >= tile._fade ? 1.0f : (float) edge / (float) tile._fade;
+}
+
+static relax_rows_t _bind_relax_rows()
+{
+	ga_cpu_tier tier = ga_cpu::get_tier();
+#if defined(GA_AVX2)
+	if (tier >= k_cpu_tier_avx2)
+	{
+		return _relax_rows_avx2;
+	}
+#endif
+#if defined(GA_SSE2)
+	if (tier >= k_cpu_tier_sse2)
+	{
+		return _relax_rows_sse2;
+	}
+#endif
+	return _relax_rows;
+}
+
+static inline float _talus_flow(float center, float neighbor, float talus)
+{
+	// what comes in from a higher neighbor less what goes out to a lower
+	// one; written the way maxps works, so every kernel rounds the same
+	float in = (neighbor - center) - talus;
+	float out = (center - neighbor) - talus;
+	return (in > 0.0f ? in : 0.0f) - (out > 0.0f ? out : 0.0f);
+}
+
+static inline float _relax_sample(const float* src, int index, int size, float talus)
+{
+	float center = src[index];
+	float flow = _talus_flow(center, src[index - 1], talus) + _talus_flow(center, src[index + 1], talus);
+	flow = flow + _talus_flow(center, src[index - size], talus);
+	flow = flow + _talus_flow(center, src[index + size], talus);
+	return center + k_thermal_rate * flow;
+}
+
+static void _relax_rows(const float* src, float* dst, int size, float talus)
+{
+	for (int j = 1; j < size - 1; j++)
+	{
+		for (int i = 1; i < size - 1; i++)
+		{
+			dst[j * size + i] = _relax_sample(src, j * size + i, size, talus);
+		}
+	}
+}
+
+#if defined(GA_SSE2)
+static inline __m128 _talus_flow4(__m128 center, __m128 neighbor, __m128 talus)
+{
+	__m128 zero = _mm_setzero_ps();
+	__m128 in = _mm_max_ps(_mm_sub_ps(_mm_sub_ps(neighbor, center), talus), zero);
+	__m128 out = _mm_max_ps(_mm_sub_ps(_mm_sub_ps(center, neighbor), talus), zero);
+	return _mm_sub_ps(in, out);
+}
+
+static void _relax_rows_sse2(const float* src, float* dst, int size, float talus)
+{
+	__m128 talus4 = _mm_set1_ps(talus);
+	__m128 rate = _mm_set1_ps(k_thermal_rate);
+
+	for (int j = 1; j < size - 1; j++)
+	{
+		int i = 1;
+		for (; i + 4 <= size - 1; i += 4)
+		{
+			const float* p = src + j * size + i;
+			__m128 center = _mm_loadu_ps(p);
+			__m128 flow = _mm_add_ps(_talus_flow4(center, _mm_loadu_ps(p - 1), talus4),
+				_talus_flow4(center, _mm_loadu_ps(p + 1), talus4));
+			flow = _mm_add_ps(flow, _talus_flow4(center, _mm_loadu_ps(p - size), talus4));
+			flow = _mm_add_ps(flow, _talus_flow4(center, _mm_loadu_ps(p + size), talus4));
+			_mm_storeu_ps(dst + j * size + i, _mm_add_ps(center, _mm_mul_ps(rate, flow)));
+		}
+		for (; i < size - 1; i++)
+		{
+			dst[j * size + i] = _relax_sample(src, j * size + i, size, talus);
+		}
+	}
+}
+#endif
+
+#if defined(GA_AVX2)
+GA_TARGET_AVX2 static inline __m256 _talus_flow8(__m256 center, __m256 neighbor, __m256 talus)
+{
+	__m256 zero = _mm256_setzero_ps();
+	__m256 in = _mm256_max_ps(_mm256_sub_ps(_mm256_sub_ps(neighbor, center), talus), zero);
+	__m256 out = _mm256_max_ps(_mm256_sub_ps(_mm256_sub_ps(center, neighbor), talus), zero);
+	return _mm256_sub_ps(in, out);
+}
+
+GA_TARGET_AVX2 static void _relax_rows_avx2(const float* src, float* dst, int size, float talus)
+{
+	__m256 talus8 = _mm256_set1_ps(talus);
+	__m256 rate = _mm256_set1_ps(k_thermal_rate);
+
+	for (int j = 1; j < size - 1; j++)
+	{
+		int i = 1;
+		for (; i + 8 <= size - 1; i += 8)
+		{
+			const float* p = src + j * size + i;
+			__m256 center = _mm256_loadu_ps(p);
+			__m256 flow = _mm256_add_ps(_talus_flow8(center, _mm256_loadu_ps(p - 1), talus8),
+				_talus_flow8(center, _mm256_loadu_ps(p + 1), talus8));
+			flow = _mm256_add_ps(flow, _talus_flow8(center, _mm256_loadu_ps(p - size), talus8));
+			flow = _mm256_add_ps(flow, _talus_flow8(center, _mm256_loadu_ps(p + size), talus8));
+			_mm256_storeu_ps(dst + j * size + i, _mm256_add_ps(center, _mm256_mul_ps(rate, flow)));
+		}
+		for (; i < size - 1; i++)
+		{
+			dst[j * size + i] = _relax_sample(src, j * size + i, size, talus);
+		}
+	}
+}
+#endif
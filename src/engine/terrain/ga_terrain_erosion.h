@@ -0,0 +1,78 @@
+#pragma once
+
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Hydraulic and thermal erosion of chunk heightmaps
+*/
+
+#include <cstdint>
+#include <vector>
+
+/*
+** A square of a heightmap for droplets to start in, and the larger region
+** around it, its apron, they may flow through and change.
+*/
+struct ga_terrain_erosion_tile
+{
+	float* _heights;
+	int _size;
+
+	// samples [x0, x1) x [z0, z1) droplets start in, and the region
+	// [region_x0, region_x1] x [region_z0, region_z1] they may change
+	int _x0;
+	int _z0;
+	int _x1;
+	int _z1;
+	int _region_x0;
+	int _region_z0;
+	int _region_x1;
+	int _region_z1;
+
+	// checkerboard pass the tile runs in, its droplets and their seed
+	int _pass;
+	int _droplets;
+	uint32_t _seed;
+
+	// scale from heightmap units to the heights droplets see, and samples
+	// from the heightmap's edges over which erosion fades in; edges stay
+	// exactly as they were
+	float _height_scale;
+	int _fade;
+};
+
+/*
+** Hydraulic erosion: droplets run downhill, picking up sediment where they
+** speed up and dropping it where they slow, carving channels and filling
+** hollows.
+** A heightmap is split into tiles eroded independently. Tiles in the same
+** pass are never close enough for their aprons to meet, so a pass can run
+** its tiles in parallel, and since each tile seeds its own droplets the
+** result doesn't depend on how they're scheduled. The heightmap's edges are
+** left untouched so eroded chunks still meet their neighbors.
+*/
+class ga_terrain_erosion
+{
+public:
+	static const int k_passes = 4;
+
+	/*
+	** Split chunk (chunk_x, chunk_z)'s size x size heightmap into tiles of
+	** tile_size samples, sorted by pass, with about droplets per sample.
+	*/
+	static void build_tiles(float* heights, int size, int chunk_x, int chunk_z, int seed, float droplets,
+		int tile_size, float height_scale, std::vector<ga_terrain_erosion_tile>& tiles);
+
+	// run a tile's droplets
+	static void erode_tile(const ga_terrain_erosion_tile& tile);
+
+	/*
+	** Thermal erosion: wherever the height difference to a neighbor is more
+	** than talus, in heightmap units, move part of the excess downhill, for
+	** the given number of iterations. Each iteration reads one buffer and
+	** writes the other, so the result is the same however it's vectorized.
+	** scratch must hold size x size; the edges are left as they were.
+	*/
+	static void relax(float* heights, float* scratch, int size, int iterations, float talus);
+};
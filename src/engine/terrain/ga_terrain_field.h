@@ -0,0 +1,143 @@
+#pragma once
+
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Procedural terrain height field
+*/
+
+#include "terrain/ga_terrain_mesh.h"
+
+#include "math/ga_vec3f.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+** Parameters read from a terrain param file.
+*/
+struct ga_terrain_params
+{
+	// number of samples along each side of a chunk (2^detail + 1)
+	int _size;
+	int _detail;
+	float _width;
+	int _height;
+	int _radius;
+	int _seed;
+
+	// order of each chunk's index buffer
+	ga_terrain_index_order _index_order;
+
+	// largest world space height error of adaptive chunk meshes; 0 draws
+	// the full grid
+	float _rtin_error;
+
+	// rings of geometry clipmap to draw instead of streaming chunks, if any,
+	// each (2^clipmap_detail + 1)^2 samples
+	int _clipmap_levels;
+	int _clipmap_detail;
+
+	// streaming options: new chunks start with detail - preview_levels and
+	// gain a level per pass, at most refine_budget passes a frame
+	int _preview_levels;
+	int _refine_budget;
+
+	// milliseconds of generation allowed per frame, counting the worker time
+	// expected for each chunk started, and separately of uploads on the GL
+	// thread, 0 for no limit
+	float _frame_budget;
+
+	// kilobytes of compressed chunks kept after they leave the radius, 0 to
+	// disable, with heights quantized to cache_bits
+	int _cache_budget;
+	int _cache_bits;
+
+	// hydraulic erosion droplets per sample run over streamed chunks, 0 to
+	// disable, in parallel tiles of erosion_tile samples
+	float _erosion;
+	int _erosion_tile;
+
+	// thermal erosion iterations run over streamed chunks after hydraulic
+	// erosion, 0 to disable, wearing slopes down to thermal_talus degrees
+	int _thermal_iterations;
+	float _thermal_talus;
+
+	// file brush edits are loaded from at startup and saved to at shutdown,
+	// relative to the root path; empty keeps them for the session only
+	std::string _edit_file;
+
+	// seconds of camera travel to prefetch chunks ahead for, 0 to disable,
+	// reaching at most prefetch_distance chunks past the radius
+	float _prefetch_time;
+	int _prefetch_distance;
+	bool _occlusion;
+	bool _stats;
+};
+
+/*
+** Stateless evaluator for the procedural terrain.
+** Heights can be queried at any world (x, z) position, whether or not a
+** chunk is loaded there. The field is immutable once constructed, so it may
+** be queried from any number of threads at once.
+*/
+class ga_terrain_field
+{
+public:
+	ga_terrain_field(const char* param_file);
+	~ga_terrain_field();
+
+	const ga_terrain_params& get_params() const { return _params; }
+
+	/*
+	** Get the world space height of the terrain at (x, z).
+	*/
+	float get_height(float x, float z) const;
+
+	/*
+	** Get world space heights for count (x, z) positions.
+	*/
+	void get_heights(const float* x, const float* z, float* heights, int count) const;
+
+	/*
+	** Get world space heights and unit surface normals for count (x, z) positions.
+	*/
+	void get_heights(const float* x, const float* z, float* heights, ga_vec3f* normals, int count) const;
+
+	/*
+	** Get the raw noise values used as chunk heightmap samples.
+	** World height is sample * height - height / 2.
+	*/
+	void get_samples(const float* x, const float* z, float* samples, int count) const;
+
+	/*
+	** Index buffer shared by every chunk grid of every stride-th sample, in
+	** the param file's index order, for chunks to copy instead of building.
+	** Grids too big for 16-bit indices use get_wide_grid_indices().
+	*/
+	const std::vector<uint16_t>& get_grid_indices(int stride) const;
+	const std::vector<uint32_t>& get_wide_grid_indices(int stride) const;
+
+private:
+	ga_terrain_params _params;
+
+	// grid index buffers by log2 of the stride
+	std::vector<uint16_t> _grid_indices[16];
+	std::vector<uint32_t> _wide_grid_indices[16];
+	int get_stride_level(int stride) const;
+
+	// the noise is sampled on a single z slice selected by the seed
+	float _slice;
+
+	// widest noise kernel the CPU supports, bound at construction; samples
+	// a multiple of its width from the start and returns how many
+	int (*_samples_kernel)(const float* x, const float* z, float* samples, int count, float slice);
+
+	// Perlin noise implementation
+	static float noise(float x, float y, float z);
+	static float fade(float t) { return t * t * t * (t * (t * 6 - 15) + 10); }
+	static float lerp(float t, float a, float b) { return a + t * (b - a); }
+	static float grad(int hash, float x, float y, float z);
+};
@@ -0,0 +1,373 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Flow directions and accumulation over the loaded chunks
+*/
+#include "ga_terrain_flow.h"
+#include "ga_terrain_chunk.h"
+#include "ga_terrain_field.h"
+
+#include <cassert>
+#include <cmath>
+
+// the eight neighbors in D8 order, and what's left for samples without one
+static const int k_offset_x[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+static const int k_offset_z[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+static const uint8_t k_flow_sink = 8;
+static const uint8_t k_flow_off_map = 9;
+
+// diagonal neighbors are further away, so the same drop is a gentler slope
+static const float k_inv_distance[8] = { 0.70710678f, 1.0f, 0.70710678f, 1.0f, 1.0f, 0.70710678f, 1.0f, 0.70710678f };
+
+static int _floor_div(int a, int b);
+
+ga_terrain_flow::ga_terrain_flow(const ga_terrain_field* field)
+{
+	_field = field;
+
+	const ga_terrain_params& params = field->get_params();
+	_size = params._size;
+	_cells = params._size - 1;
+	_width = params._width;
+	_cell = params._width / (float) _cells;
+	_height = (float) params._height;
+}
+
+int ga_terrain_flow::begin(const std::vector<ga_terrain_chunk*>& chunks)
+{
+	// tiles keep their storage between runs
+	_tiles.resize(chunks.size());
+	_index.clear();
+	for (size_t t = 0; t < chunks.size(); t++)
+	{
+		_tiles[t]._x = chunks[t]->get_x();
+		_tiles[t]._z = chunks[t]->get_z();
+		_tiles[t]._heights = chunks[t]->get_heights();
+		_index[std::make_pair(_tiles[t]._x, _tiles[t]._z)] = (int) t;
+	}
+
+	for (tile_t& tile : _tiles)
+	{
+		for (int n = 0; n < 9; n++)
+		{
+			auto found = _index.find(std::make_pair(tile._x + n % 3 - 1, tile._z + n / 3 - 1));
+			tile._neighbors[n] = found != _index.end() ? found->second : -1;
+		}
+	}
+
+	return (int) _tiles.size();
+}
+
+void ga_terrain_flow::route_tile(int index)
+{
+	tile_t& tile = _tiles[index];
+	int count = _cells * _cells;
+
+	tile._directions.resize(count);
+	tile._accumulation.assign(count, 1);
+	tile._exits.resize(count);
+	tile._pending.assign(count, 0);
+
+	// steepest descent; samples on the border may look into other tiles
+	for (int j = 0; j < _cells; j++)
+	{
+		for (int i = 0; i < _cells; i++)
+		{
+			float height = tile._heights[j * _size + i];
+			bool border = i == 0 || j == 0 || i == _cells - 1 || j == _cells - 1;
+
+			uint8_t direction = k_flow_sink;
+			float steepest = 0.0f;
+			bool missing = false;
+			for (int d = 0; d < 8; d++)
+			{
+				float neighbor;
+				if (border)
+				{
+					bool loaded;
+					neighbor = get_height(tile, i + k_offset_x[d], j + k_offset_z[d], &loaded);
+					if (!loaded)
+					{
+						missing = true;
+						continue;
+					}
+				}
+				else
+				{
+					neighbor = tile._heights[(j + k_offset_z[d]) * _size + i + k_offset_x[d]];
+				}
+
+				float slope = (height - neighbor) * k_inv_distance[d];
+				if (slope > steepest)
+				{
+					steepest = slope;
+					direction = (uint8_t) d;
+				}
+			}
+
+			// nothing lower here, but maybe past the loaded chunks
+			if (direction == k_flow_sink && missing)
+			{
+				direction = k_flow_off_map;
+			}
+			tile._directions[j * _cells + i] = direction;
+
+			if (direction < 8)
+			{
+				int ti = i + k_offset_x[direction];
+				int tj = j + k_offset_z[direction];
+				if (ti >= 0 && ti < _cells && tj >= 0 && tj < _cells)
+				{
+					tile._pending[tj * _cells + ti]++;
+				}
+			}
+		}
+	}
+
+	// accumulate from the tops of the slopes down; flow only goes downhill,
+	// so every sample gets its turn once everything above it has drained
+	tile._order.clear();
+	for (int k = 0; k < count; k++)
+	{
+		if (tile._pending[k] == 0)
+		{
+			tile._order.push_back(k);
+		}
+	}
+	for (size_t o = 0; o < tile._order.size(); o++)
+	{
+		int k = tile._order[o];
+		uint8_t direction = tile._directions[k];
+		if (direction >= 8)
+		{
+			continue;
+		}
+
+		int ti = k % _cells + k_offset_x[direction];
+		int tj = k / _cells + k_offset_z[direction];
+		if (ti >= 0 && ti < _cells && tj >= 0 && tj < _cells)
+		{
+			int target = tj * _cells + ti;
+			tile._accumulation[target] += tile._accumulation[k];
+			if (--tile._pending[target] == 0)
+			{
+				tile._order.push_back(target);
+			}
+		}
+	}
+	assert((int) tile._order.size() == count);
+
+	// and back up, so each sample finds the outlet its flow leaves by
+	tile._outlets.clear();
+	for (int o = count - 1; o >= 0; o--)
+	{
+		int k = tile._order[o];
+		uint8_t direction = tile._directions[k];
+		if (direction >= 8)
+		{
+			tile._exits[k] = -1;
+			continue;
+		}
+
+		int ti = k % _cells + k_offset_x[direction];
+		int tj = k / _cells + k_offset_z[direction];
+		if (ti >= 0 && ti < _cells && tj >= 0 && tj < _cells)
+		{
+			tile._exits[k] = tile._exits[tj * _cells + ti];
+			continue;
+		}
+
+		int ox = ti < 0 ? -1 : (ti >= _cells ? 1 : 0);
+		int oz = tj < 0 ? -1 : (tj >= _cells ? 1 : 0);
+
+		outlet_t outlet;
+		outlet._sample = k;
+		outlet._target_tile = tile._neighbors[(oz + 1) * 3 + ox + 1];
+		outlet._target_sample = (tj - oz * _cells) * _cells + ti - ox * _cells;
+		assert(outlet._target_tile >= 0);
+
+		tile._exits[k] = (int) tile._outlets.size();
+		tile._outlets.push_back(outlet);
+	}
+}
+
+void ga_terrain_flow::stitch()
+{
+	int total = 0;
+	for (tile_t& tile : _tiles)
+	{
+		tile._first_outlet = total;
+		total += (int) tile._outlets.size();
+		tile._inflows.clear();
+	}
+
+	// each outlet's flow joins the path of the sample it drains into, which
+	// leaves that tile by at most one other outlet
+	_totals.resize(total);
+	_next.assign(total, -1);
+	_incoming.assign(total, 0);
+	for (const tile_t& tile : _tiles)
+	{
+		for (size_t o = 0; o < tile._outlets.size(); o++)
+		{
+			const outlet_t& outlet = tile._outlets[o];
+			const tile_t& target = _tiles[outlet._target_tile];
+
+			int g = tile._first_outlet + (int) o;
+			_totals[g] = tile._accumulation[outlet._sample];
+
+			int exit = target._exits[outlet._target_sample];
+			if (exit >= 0)
+			{
+				_next[g] = target._first_outlet + exit;
+				_incoming[_next[g]]++;
+			}
+		}
+	}
+
+	// the same walk from the top down, over outlets instead of samples
+	_ready.clear();
+	for (int g = 0; g < total; g++)
+	{
+		if (_incoming[g] == 0)
+		{
+			_ready.push_back(g);
+		}
+	}
+	for (size_t r = 0; r < _ready.size(); r++)
+	{
+		int next = _next[_ready[r]];
+		if (next >= 0)
+		{
+			_totals[next] += _totals[_ready[r]];
+			if (--_incoming[next] == 0)
+			{
+				_ready.push_back(next);
+			}
+		}
+	}
+	assert((int) _ready.size() == total);
+
+	for (const tile_t& tile : _tiles)
+	{
+		for (size_t o = 0; o < tile._outlets.size(); o++)
+		{
+			const outlet_t& outlet = tile._outlets[o];
+			_tiles[outlet._target_tile]._inflows.push_back(
+				std::make_pair(outlet._target_sample, _totals[tile._first_outlet + (int) o]));
+		}
+	}
+}
+
+void ga_terrain_flow::finish_tile(int index)
+{
+	tile_t& tile = _tiles[index];
+
+	// what comes in runs down the same path as the tile's own flow
+	for (const std::pair<int, uint32_t>& inflow : tile._inflows)
+	{
+		int k = inflow.first;
+		for (;;)
+		{
+			tile._accumulation[k] += inflow.second;
+
+			uint8_t direction = tile._directions[k];
+			if (direction >= 8)
+			{
+				break;
+			}
+
+			int ti = k % _cells + k_offset_x[direction];
+			int tj = k / _cells + k_offset_z[direction];
+			if (ti < 0 || ti >= _cells || tj < 0 || tj >= _cells)
+			{
+				break;
+			}
+			k = tj * _cells + ti;
+		}
+	}
+}
+
+uint32_t ga_terrain_flow::get_accumulation(float x, float z) const
+{
+	// the sample grid shared by every chunk puts sample (x, z) at world (x * cell, z * cell)
+	int gx = (int) std::floor(x / _cell + 0.5f);
+	int gz = (int) std::floor(z / _cell + 0.5f);
+
+	int half = _cells / 2;
+	int cx = _floor_div(gx + half, _cells);
+	int cz = _floor_div(gz + half, _cells);
+	auto found = _index.find(std::make_pair(cx, cz));
+	if (found == _index.end())
+	{
+		return 0;
+	}
+
+	const tile_t& tile = _tiles[found->second];
+	if (tile._accumulation.empty())
+	{
+		return 0;
+	}
+
+	int i = gx - cx * _cells + half;
+	int j = gz - cz * _cells + half;
+	return tile._accumulation[j * _cells + i];
+}
+
+void ga_terrain_flow::extract_rivers(uint32_t threshold, std::vector<ga_vec3f>& rivers, std::vector<ga_vec3f>& lakes) const
+{
+	rivers.clear();
+	lakes.clear();
+
+	int half = _cells / 2;
+	for (const tile_t& tile : _tiles)
+	{
+		for (int k = 0; k < (int) tile._accumulation.size(); k++)
+		{
+			if (tile._accumulation[k] < threshold)
+			{
+				continue;
+			}
+
+			int i = k % _cells;
+			int j = k / _cells;
+			ga_vec3f position = {
+				(float) (tile._x * _cells + i - half) * _cell,
+				tile._heights[j * _size + i] * _height - _height * 0.5f,
+				(float) (tile._z * _cells + j - half) * _cell
+			};
+
+			if (tile._directions[k] == k_flow_sink)
+			{
+				lakes.push_back(position);
+			}
+			else
+			{
+				rivers.push_back(position);
+			}
+		}
+	}
+}
+
+float ga_terrain_flow::get_height(const tile_t& tile, int i, int j, bool* loaded) const
+{
+	// samples past the tile's last owned row or column belong to the next tile
+	int ox = i < 0 ? -1 : (i >= _cells ? 1 : 0);
+	int oz = j < 0 ? -1 : (j >= _cells ? 1 : 0);
+
+	int neighbor = tile._neighbors[(oz + 1) * 3 + ox + 1];
+	*loaded = neighbor >= 0;
+	if (neighbor < 0)
+	{
+		return 0.0f;
+	}
+
+	return _tiles[neighbor]._heights[(j - oz * _cells) * _size + i - ox * _cells];
+}
+
+static int _floor_div(int a, int b)
+{
+	int q = a / b;
+	return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
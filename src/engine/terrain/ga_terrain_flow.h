@@ -0,0 +1,112 @@
+#pragma once
+
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Flow directions and accumulation over the loaded chunks
+*/
+
+#include "math/ga_vec3f.h"
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+/*
+** Where water goes over the loaded terrain: each sample drains to its
+** steepest downhill neighbor of eight (D8), and a sample's accumulation is
+** how many samples drain through it, itself included. Rivers follow high
+** accumulation; sinks, samples with nowhere lower to drain, are where lakes
+** would fill.
+** Each chunk owns the samples of its heightmap but its last row and column,
+** which belong to the chunks after it, so the loaded chunks tile the world
+** without overlap. Work is split into stages so it scales with cores:
+**   route_tile()  per chunk, independently: directions, accumulation within
+**                 the chunk, and which outlet each sample's flow leaves by
+**   stitch()      once: a graph of outlets between chunks, small as the
+**                 chunks' perimeters, carrying flow from chunk to chunk
+**   finish_tile() per chunk, independently: add the flow coming in from
+**                 neighbors along its downstream paths
+** Flow may leave the loaded chunks, at samples with no lower neighbor but
+** a missing one. Chunks must not change from begin() until finishing.
+*/
+class ga_terrain_flow
+{
+public:
+	ga_terrain_flow(const class ga_terrain_field* field);
+
+	// start over with these chunks; returns how many tiles there are
+	int begin(const std::vector<class ga_terrain_chunk*>& chunks);
+
+	// the three stages; tiles may be routed or finished in parallel
+	void route_tile(int index);
+	void stitch();
+	void finish_tile(int index);
+
+	/*
+	** Samples drained through world (x, z), snapped to the nearest sample,
+	** or 0 if it isn't in a loaded chunk.
+	*/
+	uint32_t get_accumulation(float x, float z) const;
+
+	/*
+	** World positions of samples draining at least threshold samples, and
+	** of sinks collecting at least that many.
+	*/
+	void extract_rivers(uint32_t threshold, std::vector<ga_vec3f>& rivers, std::vector<ga_vec3f>& lakes) const;
+
+private:
+	// a sample whose flow leaves its tile, and where for
+	struct outlet_t
+	{
+		int _sample;
+		int _target_tile;
+		int _target_sample;
+	};
+
+	struct tile_t
+	{
+		int _x;
+		int _z;
+		const float* _heights;
+
+		// tiles around this one, row by row from (-1, -1), -1 where not loaded
+		int _neighbors[9];
+
+		// per owned sample: direction of flow, accumulation, and the outlet
+		// its flow leaves the tile by, or -1 if it ends in the tile
+		std::vector<uint8_t> _directions;
+		std::vector<uint32_t> _accumulation;
+		std::vector<int> _exits;
+
+		std::vector<outlet_t> _outlets;
+		int _first_outlet;
+
+		// flow arriving from other tiles, by owned sample
+		std::vector<std::pair<int, uint32_t> > _inflows;
+
+		// scratch for ordering the samples
+		std::vector<int> _order;
+		std::vector<uint8_t> _pending;
+	};
+
+	float get_height(const tile_t& tile, int i, int j, bool* loaded) const;
+
+	const class ga_terrain_field* _field;
+	int _size;
+	int _cells;
+	float _cell;
+	float _width;
+	float _height;
+
+	std::vector<tile_t> _tiles;
+	std::map<std::pair<int, int>, int> _index;
+
+	// the outlet graph, across all tiles
+	std::vector<uint32_t> _totals;
+	std::vector<int> _next;
+	std::vector<int> _incoming;
+	std::vector<int> _ready;
+};
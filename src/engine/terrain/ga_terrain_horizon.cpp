@@ -0,0 +1,133 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Horizon map occlusion culling for terrain chunks
+*/
+#include "ga_terrain_horizon.h"
+
+#include <algorithm>
+#include <cmath>
+
+ga_terrain_horizon::ga_terrain_horizon()
+{
+	_view_proj.make_identity();
+	_eye = ga_vec3f::zero_vector();
+	std::fill(_horizon, _horizon + k_columns, -1.0f);
+}
+
+void ga_terrain_horizon::begin(const ga_mat4f& view_proj, const ga_vec3f& eye)
+{
+	_view_proj = view_proj;
+	_eye = eye;
+
+	// nothing is covered until the first occluder is added
+	std::fill(_horizon, _horizon + k_columns, -1.0f);
+}
+
+bool ga_terrain_horizon::is_occluded(const ga_vec3f& min, const ga_vec3f& max) const
+{
+	ga_vec3f corners[8];
+	for (int i = 0; i < 8; i++)
+	{
+		corners[i] = {
+			(i & 1) ? max.x : min.x,
+			(i & 2) ? max.y : min.y,
+			(i & 4) ? max.z : min.z
+		};
+	}
+
+	ga_vec4f clip[8];
+	_view_proj.transform_points(corners, clip, 8);
+
+	float x_min = 1e30f, x_max = -1e30f, y_top = -1e30f;
+
+	for (int i = 0; i < 8; i++)
+	{
+		float ndc_x, ndc_y;
+		if (!project(clip[i], &ndc_x, &ndc_y))
+		{
+			// straddles the eye plane, so it can't be hidden by anything in front
+			return false;
+		}
+
+		x_min = std::min(x_min, ndc_x);
+		x_max = std::max(x_max, ndc_x);
+		y_top = std::max(y_top, ndc_y);
+	}
+
+	// every column the box touches must already be covered above its top
+	int first = to_column(x_min);
+	int last = to_column(x_max);
+	for (int c = first; c <= last; c++)
+	{
+		if (_horizon[c] < y_top)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void ga_terrain_horizon::add_occluder(const ga_vec3f& min, const ga_vec3f& max)
+{
+	// terrain only hides what's below it when seen from above
+	if (_eye.y <= min.y)
+	{
+		return;
+	}
+
+	ga_vec3f corners[4];
+	for (int i = 0; i < 4; i++)
+	{
+		corners[i] = { (i & 1) ? max.x : min.x, min.y, (i & 2) ? max.z : min.z };
+	}
+
+	ga_vec4f clip[4];
+	_view_proj.transform_points(corners, clip, 4);
+
+	float x_min = 1e30f, x_max = -1e30f, y_low = 1e30f;
+
+	for (int i = 0; i < 4; i++)
+	{
+		float ndc_x, ndc_y;
+		if (!project(clip[i], &ndc_x, &ndc_y))
+		{
+			return;
+		}
+
+		x_min = std::min(x_min, ndc_x);
+		x_max = std::max(x_max, ndc_x);
+		y_low = std::min(y_low, ndc_y);
+	}
+
+	// only raise columns the silhouette covers completely
+	int first = (int) std::ceil((x_min + 1.0f) * 0.5f * k_columns);
+	int last = (int) std::floor((x_max + 1.0f) * 0.5f * k_columns) - 1;
+	first = std::max(first, 0);
+	last = std::min(last, k_columns - 1);
+
+	for (int c = first; c <= last; c++)
+	{
+		_horizon[c] = std::max(_horizon[c], y_low);
+	}
+}
+
+bool ga_terrain_horizon::project(const ga_vec4f& clip, float* ndc_x, float* ndc_y)
+{
+	if (clip.w <= 1e-4f)
+	{
+		return false;
+	}
+
+	*ndc_x = clip.x / clip.w;
+	*ndc_y = clip.y / clip.w;
+	return true;
+}
+
+int ga_terrain_horizon::to_column(float ndc_x) const
+{
+	int column = (int) std::floor((ndc_x + 1.0f) * 0.5f * k_columns);
+	return std::min(std::max(column, 0), k_columns - 1);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Horizon map occlusion culling for terrain chunks
+*/
+
+#include "math/ga_mat4f.h"
+#include "math/ga_vec3f.h"
+
+/*
+** Screen space horizon for occlusion culling a heightfield.
+** Each column stores the highest normalized device y known to be covered by
+** terrain already drawn. Because terrain is solid below its surface, drawing
+** chunks front to back means everything under a nearer chunk's lowest point
+** is hidden, so a farther chunk whose box stays under the horizon in every
+** column it spans can be skipped.
+*/
+class ga_terrain_horizon
+{
+public:
+	ga_terrain_horizon();
+
+	/*
+	** Reset the horizon for a new view.
+	*/
+	void begin(const ga_mat4f& view_proj, const ga_vec3f& eye);
+
+	/*
+	** Test a box against everything added so far.
+	*/
+	bool is_occluded(const ga_vec3f& min, const ga_vec3f& max) const;
+
+	/*
+	** Raise the horizon with a chunk's conservative silhouette: its footprint
+	** at its lowest height.
+	*/
+	void add_occluder(const ga_vec3f& min, const ga_vec3f& max);
+
+private:
+	static const int k_columns = 256;
+
+	// divide a clip space point to normalized device x, y; false if behind the eye
+	static bool project(const ga_vec4f& clip, float* ndc_x, float* ndc_y);
+
+	int to_column(float ndc_x) const;
+
+	ga_mat4f _view_proj;
+	ga_vec3f _eye;
+	float _horizon[k_columns];
+};
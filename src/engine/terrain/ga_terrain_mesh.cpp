@@ -0,0 +1,425 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Index generation for terrain chunk meshes
+*/
+#include "ga_terrain_mesh.h"
+
+#include "framework/ga_compiler_defines.h"
+#include "framework/ga_cpu.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#if defined(GA_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(GA_AVX2)
+#include <immintrin.h>
+#endif
+
+static const char* k_index_order_names[] = { "rows", "morton", "hilbert", "strips" };
+
+typedef void (*build_vertices_t)(const float* samples, int size, int stride, float center_x, float center_z,
+	float width, float scale, float offset, ga_vec3f* vertices);
+
+// kernels by detail level, 0 for grids of any other size
+struct build_vertices_kernels_t
+{
+	build_vertices_t _kernels[10];
+};
+
+static build_vertices_kernels_t _bind_build_vertices();
+template <int Detail> static build_vertices_t _select_build_vertices(ga_cpu_tier tier);
+template <int Detail, bool Simd> static void _build_vertices(const float* samples, int size, int stride, float center_x, float center_z,
+	float width, float scale, float offset, ga_vec3f* vertices);
+#if defined(GA_AVX2)
+template <int Detail> GA_TARGET_AVX2 static void _build_vertices_avx2(const float* samples, int size, int stride,
+	float center_x, float center_z, float width, float scale, float offset, ga_vec3f* vertices);
+#endif
+#if defined(GA_SSE2)
+static void _store_vertices4(float* out, __m128 x4, __m128 y4, __m128 z4);
+#endif
+template <typename T> static void _build_indices(ga_terrain_index_order order, int size, std::vector<T>& indices);
+template <typename T> static float _compute_acmr(const std::vector<T>& indices, bool strip, int cache_size);
+template <typename T> static void _push_quad(std::vector<T>& indices, int size, int x, int y);
+static void _morton_to_xy(int d, int* x, int* y);
+static void _hilbert_to_xy(int n, int d, int* x, int* y);
+
+void ga_terrain_mesh::build_vertices(const float* samples, int size, int stride, float center_x, float center_z,
+	float width, float scale, float offset, ga_vec3f* vertices)
+{
+	// bound on first use to the CPU's widest kernels
+	static const build_vertices_kernels_t bound = _bind_build_vertices();
+
+	// grids of the common detail levels get loops with fixed trip counts
+	int grid = (size - 1) / stride;
+	int level = 0;
+	for (int detail = 4; detail <= 9; detail++)
+	{
+		if (grid == 1 << detail)
+		{
+			level = detail;
+		}
+	}
+
+	bound._kernels[level](samples, size, stride, center_x, center_z, width, scale, offset, vertices);
+}
+
+void ga_terrain_mesh::build_indices(ga_terrain_index_order order, int size, std::vector<uint16_t>& indices)
+{
+	assert(!needs_wide_indices(size));
+	_build_indices(order, size, indices);
+}
+
+void ga_terrain_mesh::build_indices(ga_terrain_index_order order, int size, std::vector<uint32_t>& indices)
+{
+	_build_indices(order, size, indices);
+}
+
+float ga_terrain_mesh::compute_acmr(const std::vector<uint16_t>& indices, bool strip, int cache_size)
+{
+	return _compute_acmr(indices, strip, cache_size);
+}
+
+float ga_terrain_mesh::compute_acmr(const std::vector<uint32_t>& indices, bool strip, int cache_size)
+{
+	return _compute_acmr(indices, strip, cache_size);
+}
+
+bool ga_terrain_mesh::parse_index_order(const char* name, ga_terrain_index_order* order)
+{
+	for (int i = 0; i <= k_index_order_strips; i++)
+	{
+		if (strcmp(name, k_index_order_names[i]) == 0)
+		{
+			*order = (ga_terrain_index_order) i;
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* ga_terrain_mesh::get_index_order_name(ga_terrain_index_order order)
+{
+	return k_index_order_names[order];
+}
+
+template <typename T>
+static void _build_indices(ga_terrain_index_order order, int size, std::vector<T>& indices)
+{
+	const T restart_index = (T) ~0u;
+
+	int quads = size - 1;
+	indices.clear();
+
+	switch (order)
+	{
+	case k_index_order_rows:
+		indices.reserve(6 * quads * quads);
+		for (int y = 0; y < quads; y++)
+		{
+			for (int x = 0; x < quads; x++)
+			{
+				_push_quad(indices, size, x, y);
+			}
+		}
+		break;
+
+	case k_index_order_morton:
+		indices.reserve(6 * quads * quads);
+		for (int d = 0; d < quads * quads; d++)
+		{
+			int x, y;
+			_morton_to_xy(d, &x, &y);
+			_push_quad(indices, size, x, y);
+		}
+		break;
+
+	case k_index_order_hilbert:
+		indices.reserve(6 * quads * quads);
+		for (int d = 0; d < quads * quads; d++)
+		{
+			int x, y;
+			_hilbert_to_xy(quads, d, &x, &y);
+			_push_quad(indices, size, x, y);
+		}
+		break;
+
+	case k_index_order_strips:
+		indices.reserve(quads * (2 * size + 1));
+		for (int y = 0; y < quads; y++)
+		{
+			// lower row first, so the strip splits each quad along the same
+			// diagonal as the triangle lists
+			for (int x = 0; x < size; x++)
+			{
+				indices.push_back((T) (x + size * (y + 1)));
+				indices.push_back((T) (x + size * y));
+			}
+			if (y < quads - 1)
+			{
+				indices.push_back(restart_index);
+			}
+		}
+		break;
+	}
+}
+
+template <typename T>
+static float _compute_acmr(const std::vector<T>& indices, bool strip, int cache_size)
+{
+	const T restart_index = (T) ~0u;
+
+	std::vector<int> cache(cache_size, -1);
+	int head = 0;
+	int misses = 0;
+	int triangles = 0;
+	int strip_length = 0;
+
+	for (T index : indices)
+	{
+		if (strip && index == restart_index)
+		{
+			strip_length = 0;
+			continue;
+		}
+
+		if (std::find(cache.begin(), cache.end(), (int) index) == cache.end())
+		{
+			misses++;
+			cache[head] = index;
+			head = (head + 1) % cache_size;
+		}
+
+		if (strip)
+		{
+			strip_length++;
+			triangles += strip_length >= 3 ? 1 : 0;
+		}
+	}
+
+	if (!strip)
+	{
+		triangles = (int) indices.size() / 3;
+	}
+
+	return triangles > 0 ? (float) misses / (float) triangles : 0.0f;
+}
+
+template <typename T>
+static void _push_quad(std::vector<T>& indices, int size, int x, int y)
+{
+	indices.push_back((T) (x + size * y));
+	indices.push_back((T) (x + 1 + size * y));
+	indices.push_back((T) (x + 1 + size * (y + 1)));
+	indices.push_back((T) (x + 1 + size * (y + 1)));
+	indices.push_back((T) (x + size * (y + 1)));
+	indices.push_back((T) (x + size * y));
+}
+
+static void _morton_to_xy(int d, int* x, int* y)
+{
+	// even bits are x, odd bits are y
+	*x = 0;
+	*y = 0;
+	for (int bit = 0; bit < 16; bit++)
+	{
+		*x |= ((d >> (2 * bit)) & 1) << bit;
+		*y |= ((d >> (2 * bit + 1)) & 1) << bit;
+	}
+}
+
+// Hilbert curve index to coordinates on an n x n grid, n a power of two.
+// https://en.wikipedia.org/wiki/Hilbert_curve
+static void _hilbert_to_xy(int n, int d, int* x, int* y)
+{
+	*x = 0;
+	*y = 0;
+	for (int s = 1; s < n; s *= 2)
+	{
+		int rx = 1 & (d / 2);
+		int ry = 1 & (d ^ rx);
+
+		// rotate the quadrant
+		if (ry == 0)
+		{
+			if (rx == 1)
+			{
+				*x = s - 1 - *x;
+				*y = s - 1 - *y;
+			}
+			std::swap(*x, *y);
+		}
+
+		*x += s * rx;
+		*y += s * ry;
+		d /= 4;
+	}
+}
+
+static build_vertices_kernels_t _bind_build_vertices()
+{
+	ga_cpu_tier tier = ga_cpu::get_tier();
+
+	build_vertices_kernels_t bound;
+	for (int level = 0; level < 10; level++)
+	{
+		bound._kernels[level] = _select_build_vertices<0>(tier);
+	}
+	bound._kernels[4] = _select_build_vertices<4>(tier);
+	bound._kernels[5] = _select_build_vertices<5>(tier);
+	bound._kernels[6] = _select_build_vertices<6>(tier);
+	bound._kernels[7] = _select_build_vertices<7>(tier);
+	bound._kernels[8] = _select_build_vertices<8>(tier);
+	bound._kernels[9] = _select_build_vertices<9>(tier);
+	return bound;
+}
+
+template <int Detail>
+static build_vertices_t _select_build_vertices(ga_cpu_tier tier)
+{
+#if defined(GA_AVX2)
+	if (tier >= k_cpu_tier_avx2)
+	{
+		return _build_vertices_avx2<Detail>;
+	}
+#endif
+	if (tier >= k_cpu_tier_sse2)
+	{
+		return _build_vertices<Detail, true>;
+	}
+	return _build_vertices<Detail, false>;
+}
+
+template <int Detail, bool Simd>
+static void _build_vertices(const float* samples, int size, int stride, float center_x, float center_z,
+	float width, float scale, float offset, ga_vec3f* vertices)
+{
+	// Detail 0 takes the grid size at run time
+	const int n = Detail > 0 ? (1 << Detail) + 1 : (size - 1) / stride + 1;
+	assert(n == (size - 1) / stride + 1);
+
+	// positions are offsets from the center, so neighboring chunks compute
+	// exactly the same coordinates along the edge they share
+	float spacing = (float) stride * width / (float) (size - 1);
+	float half = width * 0.5f;
+	int row_step = stride * size;
+
+	for (int i = 0; i < n; i++)
+	{
+		const float* column = samples + i * stride;
+		float x = center_x + ((float) i * spacing - half);
+		float* out = &vertices[i * n].x;
+		int j = 0;
+
+#if defined(GA_SSE2)
+		if (Simd)
+		{
+			__m128 x4 = _mm_set1_ps(x);
+			__m128 j4 = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+			__m128 step4 = _mm_set1_ps(4.0f);
+			__m128 spacing4 = _mm_set1_ps(spacing);
+			__m128 half4 = _mm_set1_ps(half);
+			__m128 center4 = _mm_set1_ps(center_z);
+			__m128 scale4 = _mm_set1_ps(scale);
+			__m128 offset4 = _mm_set1_ps(offset);
+
+			for (; j + 4 <= n; j += 4)
+			{
+				const float* h = column + j * row_step;
+				__m128 heights = _mm_setr_ps(h[0], h[row_step], h[2 * row_step], h[3 * row_step]);
+				__m128 y4 = _mm_add_ps(_mm_mul_ps(heights, scale4), offset4);
+				__m128 z4 = _mm_add_ps(center4, _mm_sub_ps(_mm_mul_ps(j4, spacing4), half4));
+				j4 = _mm_add_ps(j4, step4);
+
+				_store_vertices4(out + 3 * j, x4, y4, z4);
+			}
+		}
+#endif
+
+		for (; j < n; j++)
+		{
+			out[3 * j] = x;
+			out[3 * j + 1] = column[j * row_step] * scale + offset;
+			out[3 * j + 2] = center_z + ((float) j * spacing - half);
+		}
+	}
+}
+
+#if defined(GA_AVX2)
+/*
+** As _build_vertices, gathering eight heights down a column at a time.
+** Without FMA, so vertices match the other kernels bit for bit.
+*/
+template <int Detail>
+GA_TARGET_AVX2 static void _build_vertices_avx2(const float* samples, int size, int stride,
+	float center_x, float center_z, float width, float scale, float offset, ga_vec3f* vertices)
+{
+	const int n = Detail > 0 ? (1 << Detail) + 1 : (size - 1) / stride + 1;
+	assert(n == (size - 1) / stride + 1);
+
+	float spacing = (float) stride * width / (float) (size - 1);
+	float half = width * 0.5f;
+	int row_step = stride * size;
+
+	__m256i rows = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(row_step));
+	__m256 step8 = _mm256_set1_ps(8.0f);
+	__m256 spacing8 = _mm256_set1_ps(spacing);
+	__m256 half8 = _mm256_set1_ps(half);
+	__m256 center8 = _mm256_set1_ps(center_z);
+	__m256 scale8 = _mm256_set1_ps(scale);
+	__m256 offset8 = _mm256_set1_ps(offset);
+
+	for (int i = 0; i < n; i++)
+	{
+		const float* column = samples + i * stride;
+		float x = center_x + ((float) i * spacing - half);
+		float* out = &vertices[i * n].x;
+		int j = 0;
+
+		__m128 x4 = _mm_set1_ps(x);
+		__m256 j8 = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+
+		for (; j + 8 <= n; j += 8)
+		{
+			__m256 heights = _mm256_i32gather_ps(column + j * row_step, rows, 4);
+			__m256 y8 = _mm256_add_ps(_mm256_mul_ps(heights, scale8), offset8);
+			__m256 z8 = _mm256_add_ps(center8, _mm256_sub_ps(_mm256_mul_ps(j8, spacing8), half8));
+			j8 = _mm256_add_ps(j8, step8);
+
+			_store_vertices4(out + 3 * j, x4, _mm256_castps256_ps128(y8), _mm256_castps256_ps128(z8));
+			_store_vertices4(out + 3 * j + 12, x4, _mm256_extractf128_ps(y8, 1), _mm256_extractf128_ps(z8, 1));
+		}
+
+		for (; j < n; j++)
+		{
+			out[3 * j] = x;
+			out[3 * j + 1] = column[j * row_step] * scale + offset;
+			out[3 * j + 2] = center_z + ((float) j * spacing - half);
+		}
+	}
+}
+#endif
+
+#if defined(GA_SSE2)
+/*
+** Write four vertices, transposed from x, y, z registers into the three
+** registers they occupy in memory.
+*/
+static inline void _store_vertices4(float* out, __m128 x4, __m128 y4, __m128 z4)
+{
+	__m128 xy_lo = _mm_unpacklo_ps(x4, y4);   // x y0 x y1
+	__m128 zx_lo = _mm_unpacklo_ps(z4, x4);   // z0 x z1 x
+	__m128 yz_lo = _mm_unpacklo_ps(y4, z4);   // y0 z0 y1 z1
+	__m128 xy_hi = _mm_unpackhi_ps(x4, y4);   // x y2 x y3
+	__m128 zx_hi = _mm_unpackhi_ps(z4, x4);   // z2 x z3 x
+	__m128 yz_hi = _mm_unpackhi_ps(y4, z4);   // y2 z2 y3 z3
+
+	_mm_storeu_ps(out, _mm_shuffle_ps(xy_lo, zx_lo, _MM_SHUFFLE(1, 0, 1, 0)));
+	_mm_storeu_ps(out + 4, _mm_shuffle_ps(yz_lo, xy_hi, _MM_SHUFFLE(1, 0, 3, 2)));
+	_mm_storeu_ps(out + 8, _mm_shuffle_ps(zx_hi, yz_hi, _MM_SHUFFLE(3, 2, 1, 0)));
+}
+#endif
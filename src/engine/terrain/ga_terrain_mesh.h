@@ -0,0 +1,69 @@
+#pragma once
+
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Index generation for terrain chunk meshes
+*/
+
+#include "math/ga_vec3f.h"
+
+#include <cstdint>
+#include <vector>
+
+/*
+** Order in which a chunk's grid quads are emitted.
+** Ordering changes nothing about the mesh except how well the GPU's
+** post-transform vertex cache is reused.
+*/
+enum ga_terrain_index_order
+{
+	k_index_order_rows,     // row by row, the original ordering
+	k_index_order_morton,   // quads in Z-order tiles
+	k_index_order_hilbert,  // quads along a Hilbert curve
+	k_index_order_strips,   // one triangle strip per row, primitive restart between
+};
+
+/*
+** Builds vertex and index buffers for (2^n + 1)^2 chunk grids and measures them.
+** Vertex (x, y) of the grid is index x + size * y. Strips are separated by
+** the largest value of the index type.
+*/
+class ga_terrain_mesh
+{
+public:
+	/*
+	** Whether a size x size grid needs 32-bit indices. 16-bit indices reach
+	** detail 7; the restart index is reserved, so 2^16 - 1 vertices at most.
+	*/
+	static bool needs_wide_indices(int size) { return size * size > 0xffff; }
+
+	/*
+	** Write the grid of every stride-th sample of a size x size heightmap to
+	** vertices, which must hold ((size - 1) / stride + 1)^2 of them. Sample
+	** (x, y) lands at (center_x + x * spacing - width / 2, sample * scale +
+	** offset, center_z + y * spacing - width / 2), as grid vertex x * n + y.
+	*/
+	static void build_vertices(const float* samples, int size, int stride, float center_x, float center_z,
+		float width, float scale, float offset, ga_vec3f* vertices);
+
+	/*
+	** Fill indices with the grid's triangles in the given order. Every order
+	** but strips produces a triangle list.
+	*/
+	static void build_indices(ga_terrain_index_order order, int size, std::vector<uint16_t>& indices);
+	static void build_indices(ga_terrain_index_order order, int size, std::vector<uint32_t>& indices);
+
+	static bool is_strip(ga_terrain_index_order order) { return order == k_index_order_strips; }
+
+	/*
+	** Simulate a FIFO post-transform cache of cache_size vertices and return
+	** the average number of misses per triangle.
+	*/
+	static float compute_acmr(const std::vector<uint16_t>& indices, bool strip, int cache_size);
+	static float compute_acmr(const std::vector<uint32_t>& indices, bool strip, int cache_size);
+
+	static bool parse_index_order(const char* name, ga_terrain_index_order* order);
+	static const char* get_index_order_name(ga_terrain_index_order order);
+};
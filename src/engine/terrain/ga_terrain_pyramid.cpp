@@ -0,0 +1,239 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Min/max height pyramid for terrain chunks
+*/
+#include "ga_terrain_pyramid.h"
+
+#include "math/ga_math.h"
+
+#include <algorithm>
+#include <cassert>
+
+static bool _intersect_triangle(const ga_vec3f& origin, const ga_vec3f& dir,
+	const ga_vec3f& a, const ga_vec3f& b, const ga_vec3f& c, float* t);
+
+ga_terrain_pyramid::ga_terrain_pyramid()
+{
+	_samples = 0;
+	_size = 0;
+	_levels = 0;
+	_min = 0;
+	_max = 0;
+}
+
+ga_terrain_pyramid::~ga_terrain_pyramid()
+{
+	delete[] _min;
+	delete[] _max;
+}
+
+void ga_terrain_pyramid::build(const float* samples, int size, float scale, float offset)
+{
+	// rebuilding at the same size, as refinement does, reuses the levels
+	bool resized = size != _size || _min == 0;
+
+	_samples = samples;
+	_size = size;
+	_scale = scale;
+	_offset = offset;
+
+	// count levels and lay them out back to back, finest first
+	int cells = size - 1;
+	int total = 0;
+	_levels = 0;
+	for (int n = cells; n >= 1; n >>= 1)
+	{
+		assert(_levels < 16);
+		_level_offsets[_levels++] = total;
+		total += n * n;
+	}
+
+	if (resized)
+	{
+		delete[] _min;
+		delete[] _max;
+		_min = new float[total];
+		_max = new float[total];
+	}
+
+	// level 0 bounds the four corners of each cell
+	for (int z = 0; z < cells; z++)
+	{
+		for (int x = 0; x < cells; x++)
+		{
+			float h00 = get_height(x, z);
+			float h10 = get_height(x + 1, z);
+			float h01 = get_height(x, z + 1);
+			float h11 = get_height(x + 1, z + 1);
+
+			_min[z * cells + x] = std::min(std::min(h00, h10), std::min(h01, h11));
+			_max[z * cells + x] = std::max(std::max(h00, h10), std::max(h01, h11));
+		}
+	}
+
+	// every other level reduces 2x2 cells of the level below
+	for (int level = 1; level < _levels; level++)
+	{
+		int n = cells >> level;
+		const float* child_min = _min + _level_offsets[level - 1];
+		const float* child_max = _max + _level_offsets[level - 1];
+		float* level_min = _min + _level_offsets[level];
+		float* level_max = _max + _level_offsets[level];
+
+		for (int z = 0; z < n; z++)
+		{
+			for (int x = 0; x < n; x++)
+			{
+				int c = (2 * z) * (2 * n) + 2 * x;
+				level_min[z * n + x] = std::min(
+					std::min(child_min[c], child_min[c + 1]),
+					std::min(child_min[c + 2 * n], child_min[c + 2 * n + 1]));
+				level_max[z * n + x] = std::max(
+					std::max(child_max[c], child_max[c + 1]),
+					std::max(child_max[c + 2 * n], child_max[c + 2 * n + 1]));
+			}
+		}
+	}
+}
+
+bool ga_terrain_pyramid::raycast(const ga_vec3f& origin, const ga_vec3f& dir, float t_max, float* t) const
+{
+	if (_levels == 0)
+	{
+		return false;
+	}
+
+	// large finite reciprocals keep the slab tests free of NaNs
+	ga_vec3f inv;
+	for (int i = 0; i < 3; i++)
+	{
+		float d = dir.axes[i];
+		inv.axes[i] = ga_absf(d) > 1e-12f ? 1.0f / d : (d < 0.0f ? -1e30f : 1e30f);
+	}
+
+	// visit the nearer children first so most rays terminate early
+	int near_x = dir.x >= 0.0f ? 0 : 1;
+	int near_z = dir.z >= 0.0f ? 0 : 1;
+
+	struct node_t { int _level, _x, _z; };
+	node_t stack[64];
+	int top = 0;
+	stack[top++] = { _levels - 1, 0, 0 };
+
+	float best = t_max;
+	bool hit = false;
+
+	while (top > 0)
+	{
+		node_t node = stack[--top];
+
+		int cells = (_size - 1) >> node._level;
+		int index = _level_offsets[node._level] + node._z * cells + node._x;
+		float extent = (float) (1 << node._level);
+
+		float lo[3] = { node._x * extent, _min[index], node._z * extent };
+		float hi[3] = { lo[0] + extent, _max[index], lo[2] + extent };
+
+		// slab test against the node's bounds
+		float t_enter = 0.0f;
+		float t_exit = best;
+		for (int i = 0; i < 3; i++)
+		{
+			float t0 = (lo[i] - origin.axes[i]) * inv.axes[i];
+			float t1 = (hi[i] - origin.axes[i]) * inv.axes[i];
+			if (t0 > t1) std::swap(t0, t1);
+			t_enter = std::max(t_enter, t0);
+			t_exit = std::min(t_exit, t1);
+		}
+		if (t_enter > t_exit)
+		{
+			continue;
+		}
+
+		if (node._level == 0)
+		{
+			float cell_t;
+			if (intersect_cell(node._x, node._z, origin, dir, &cell_t) && cell_t <= best)
+			{
+				best = cell_t;
+				hit = true;
+			}
+			continue;
+		}
+
+		// push farthest child first so the nearest is popped next
+		int level = node._level - 1;
+		int x = node._x * 2;
+		int z = node._z * 2;
+		stack[top++] = { level, x + 1 - near_x, z + 1 - near_z };
+		stack[top++] = { level, x + near_x, z + 1 - near_z };
+		stack[top++] = { level, x + 1 - near_x, z + near_z };
+		stack[top++] = { level, x + near_x, z + near_z };
+	}
+
+	if (hit)
+	{
+		*t = best;
+	}
+	return hit;
+}
+
+bool ga_terrain_pyramid::intersect_cell(int x, int z, const ga_vec3f& origin, const ga_vec3f& dir, float* t) const
+{
+	// same split as the chunk mesh: (0,0) (1,0) (1,1) and (1,1) (0,1) (0,0)
+	ga_vec3f v00 = { (float) x, get_height(x, z), (float) z };
+	ga_vec3f v10 = { (float) x + 1, get_height(x + 1, z), (float) z };
+	ga_vec3f v11 = { (float) x + 1, get_height(x + 1, z + 1), (float) z + 1 };
+	ga_vec3f v01 = { (float) x, get_height(x, z + 1), (float) z + 1 };
+
+	float t0, t1;
+	bool hit0 = _intersect_triangle(origin, dir, v00, v10, v11, &t0);
+	bool hit1 = _intersect_triangle(origin, dir, v11, v01, v00, &t1);
+
+	if (hit0 && (!hit1 || t0 < t1))
+	{
+		*t = t0;
+		return true;
+	}
+	if (hit1)
+	{
+		*t = t1;
+		return true;
+	}
+	return false;
+}
+
+// Moller-Trumbore ray/triangle test, accepting either winding
+static bool _intersect_triangle(const ga_vec3f& origin, const ga_vec3f& dir,
+	const ga_vec3f& a, const ga_vec3f& b, const ga_vec3f& c, float* t)
+{
+	ga_vec3f edge1 = b - a;
+	ga_vec3f edge2 = c - a;
+	ga_vec3f p = ga_vec3f_cross(dir, edge2);
+
+	float det = edge1.dot(p);
+	if (ga_absf(det) < 1e-12f)
+	{
+		return false;
+	}
+	float inv_det = 1.0f / det;
+
+	ga_vec3f s = origin - a;
+	float u = s.dot(p) * inv_det;
+	if (u < 0.0f || u > 1.0f)
+	{
+		return false;
+	}
+
+	ga_vec3f q = ga_vec3f_cross(s, edge1);
+	float v = dir.dot(q) * inv_det;
+	if (v < 0.0f || u + v > 1.0f)
+	{
+		return false;
+	}
+
+	*t = edge2.dot(q) * inv_det;
+	return *t >= 0.0f;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Min/max height pyramid for terrain chunks
+*/
+
+#include "math/ga_vec3f.h"
+
+#include <cfloat>
+
+/*
+** Hierarchy of min/max heights over a (2^n + 1)^2 chunk heightmap.
+** Level 0 bounds each grid cell, and each level above bounds 2x2 cells of
+** the one below, up to a single root cell covering the whole chunk.
+** Used to skip empty space when marching rays over the terrain.
+*/
+class ga_terrain_pyramid
+{
+public:
+	ga_terrain_pyramid();
+	~ga_terrain_pyramid();
+
+	/*
+	** Build the pyramid over a size * size grid of samples.
+	** World height of a sample is sample * scale + offset. The samples are
+	** referenced, not copied, and must outlive the pyramid.
+	*/
+	void build(const float* samples, int size, float scale, float offset);
+
+	// bounds of the whole chunk, empty (min above max) until built
+	float get_min() const { return _levels > 0 ? _min[_level_offsets[_levels - 1]] : FLT_MAX; }
+	float get_max() const { return _levels > 0 ? _max[_level_offsets[_levels - 1]] : -FLT_MAX; }
+
+	/*
+	** Intersect a ray with the triangulated heightmap.
+	** The ray is given in grid space: x and z in units of grid cells from the
+	** first sample, y in world units. Returns the nearest hit t in [0, t_max].
+	*/
+	bool raycast(const ga_vec3f& origin, const ga_vec3f& dir, float t_max, float* t) const;
+
+private:
+	float get_height(int x, int z) const { return _samples[z * _size + x] * _scale + _offset; }
+
+	bool intersect_cell(int x, int z, const ga_vec3f& origin, const ga_vec3f& dir, float* t) const;
+
+	const float* _samples;
+	int _size;
+	float _scale;
+	float _offset;
+
+	int _levels;
+	int _level_offsets[16];
+	float* _min;
+	float* _max;
+};
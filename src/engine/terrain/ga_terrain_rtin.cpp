@@ -0,0 +1,141 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Right-triangulated irregular network meshing for terrain chunks
+*/
+#include "ga_terrain_rtin.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+ga_terrain_rtin::ga_terrain_rtin()
+{
+	_size = 0;
+	_errors = 0;
+}
+
+ga_terrain_rtin::~ga_terrain_rtin()
+{
+	delete[] _errors;
+}
+
+void ga_terrain_rtin::build(const float* samples, int size, float scale)
+{
+	int tiles = size - 1;
+	assert(tiles > 0 && (tiles & (tiles - 1)) == 0);
+
+	if (size != _size || _errors == 0)
+	{
+		delete[] _errors;
+		_size = size;
+		_errors = new float[size * size];
+	}
+
+	// pinning the border before propagating also forces every triangle
+	// above a border vertex to split, so the mesh stays conforming
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			bool border = x == 0 || y == 0 || x == tiles || y == tiles;
+			_errors[x + size * y] = border ? FLT_MAX : 0.0f;
+		}
+	}
+
+	// Triangles are numbered as a binary tree: 0 and 1 are the two halves of
+	// the chunk and the children of triangle t are 2t + 2 and 2t + 3. Walking
+	// them backwards visits every level before the one above it, so each
+	// vertex has its final error by the time its parents read it.
+	int triangle_count = tiles * tiles * 2 - 2;
+	int parent_count = triangle_count - tiles * tiles;
+
+	for (int t = triangle_count - 1; t >= 0; t--)
+	{
+		// decode the triangle: hypotenuse a-b, right angle at c
+		int id = t + 2;
+		int ax = 0, ay = 0, bx = 0, by = 0, cx = 0, cy = 0;
+		if (id & 1)
+		{
+			bx = by = cx = tiles;
+		}
+		else
+		{
+			ax = ay = cy = tiles;
+		}
+		while ((id >>= 1) > 1)
+		{
+			int mx = (ax + bx) >> 1;
+			int my = (ay + by) >> 1;
+			if (id & 1)
+			{
+				bx = ax; by = ay;
+				ax = cx; ay = cy;
+			}
+			else
+			{
+				ax = bx; ay = by;
+				bx = cx; by = cy;
+			}
+			cx = mx;
+			cy = my;
+		}
+
+		// error of dropping the hypotenuse midpoint
+		int mx = (ax + bx) >> 1;
+		int my = (ay + by) >> 1;
+		float interpolated = (samples[ax + size * ay] + samples[bx + size * by]) * 0.5f;
+		float error = std::fabs(interpolated - samples[mx + size * my]) * scale;
+
+		float& middle = _errors[mx + size * my];
+		middle = std::max(middle, error);
+
+		if (t < parent_count)
+		{
+			// the midpoint has to be kept wherever either child must split
+			int left = ((ax + cx) >> 1) + size * ((ay + cy) >> 1);
+			int right = ((bx + cx) >> 1) + size * ((by + cy) >> 1);
+			middle = std::max(middle, std::max(_errors[left], _errors[right]));
+		}
+	}
+}
+
+int ga_terrain_rtin::extract(float max_error, std::vector<uint32_t>& triangles) const
+{
+	size_t first = triangles.size();
+	int tiles = _size - 1;
+
+	extract_triangle(0, 0, tiles, tiles, tiles, 0, max_error, triangles);
+	extract_triangle(tiles, tiles, 0, 0, 0, tiles, max_error, triangles);
+
+	return (int) (triangles.size() - first) / 3;
+}
+
+void ga_terrain_rtin::extract_triangle(int ax, int ay, int bx, int by, int cx, int cy,
+	float max_error, std::vector<uint32_t>& triangles) const
+{
+	int mx = (ax + bx) >> 1;
+	int my = (ay + by) >> 1;
+
+	if (std::abs(ax - cx) + std::abs(ay - cy) > 1 && _errors[mx + _size * my] > max_error)
+	{
+		extract_triangle(cx, cy, ax, ay, mx, my, max_error, triangles);
+		extract_triangle(bx, by, cx, cy, mx, my, max_error, triangles);
+		return;
+	}
+
+	// match the grid mesh's winding, whose triangles all turn the positive
+	// way in x, y sample space
+	int cross = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+	if (cross < 0)
+	{
+		std::swap(bx, cx);
+		std::swap(by, cy);
+	}
+
+	triangles.push_back(ax + _size * ay);
+	triangles.push_back(bx + _size * by);
+	triangles.push_back(cx + _size * cy);
+}
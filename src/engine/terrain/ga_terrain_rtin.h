@@ -0,0 +1,51 @@
+#pragma once
+
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Right-triangulated irregular network meshing for terrain chunks
+*/
+
+#include <cstdint>
+#include <vector>
+
+/*
+** Error hierarchy over a (2^n + 1)^2 chunk heightmap.
+** The grid is recursively bisected into right triangles, and every vertex
+** stores the largest height error that leaving it out would introduce in
+** any triangle below it. Extracting a mesh for a given error then only
+** splits triangles that need it, so flat ground collapses to a few large
+** triangles while rough ground keeps full detail.
+** After Evans, Kirkpatrick and Townsend, "Right-Triangulated Irregular
+** Networks".
+*/
+class ga_terrain_rtin
+{
+public:
+	ga_terrain_rtin();
+	~ga_terrain_rtin();
+
+	/*
+	** Build the hierarchy over a size * size grid of samples, indexed
+	** x + size * y. World height of a sample is sample * scale, plus an
+	** offset that never changes an error.
+	** Border vertices are always kept so neighboring chunks meet without
+	** cracks, whatever their own terrain looks like.
+	*/
+	void build(const float* samples, int size, float scale);
+
+	/*
+	** Triangulate to within max_error world units of the full grid.
+	** Appends three sample indices per triangle, wound like the full grid
+	** mesh, and returns the number of triangles.
+	*/
+	int extract(float max_error, std::vector<uint32_t>& triangles) const;
+
+private:
+	void extract_triangle(int ax, int ay, int bx, int by, int cx, int cy,
+		float max_error, std::vector<uint32_t>& triangles) const;
+
+	int _size;
+	float* _errors;
+};
@@ -0,0 +1,91 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Frame budgeted scheduling of terrain generation
+*/
+#include "ga_terrain_scheduler.h"
+
+#include <algorithm>
+
+ga_terrain_scheduler::ga_terrain_scheduler()
+{
+	_next = 0;
+	_budget_ms = 0.0f;
+	_charged_ms = 0.0f;
+	_serviced = 0;
+	_latency_ms = 0.0f;
+}
+
+void ga_terrain_scheduler::begin_frame(const std::set<std::pair<int, int> >& wanted)
+{
+	_frame_start = std::chrono::high_resolution_clock::now();
+	_charged_ms = 0.0f;
+	_serviced = 0;
+	_latency_ms = 0.0f;
+
+	// forget what was serviced last frame and anything that's gone out of range
+	std::set<std::pair<int, int> > queued;
+	int kept = 0;
+	for (int i = _next; i < (int) _requests.size(); i++)
+	{
+		std::pair<int, int> key = std::make_pair(_requests[i]._x, _requests[i]._z);
+		if (wanted.count(key) != 0)
+		{
+			queued.insert(key);
+			_requests[kept++] = _requests[i];
+		}
+	}
+	_requests.resize(kept);
+	_next = 0;
+
+	// and queue whatever is newly wanted
+	for (auto& key : wanted)
+	{
+		if (queued.count(key) == 0)
+		{
+			ga_terrain_request request;
+			request._x = key.first;
+			request._z = key.second;
+			request._priority = 0.0f;
+			request._queued = _frame_start;
+			_requests.push_back(request);
+		}
+	}
+}
+
+void ga_terrain_scheduler::sort()
+{
+	std::sort(_requests.begin() + _next, _requests.end(),
+		[](const ga_terrain_request& a, const ga_terrain_request& b)
+		{
+			return a._priority < b._priority;
+		});
+}
+
+bool ga_terrain_scheduler::next(ga_terrain_request* request)
+{
+	if (_next >= (int) _requests.size() || (_serviced > 0 && !has_time()))
+	{
+		return false;
+	}
+
+	*request = _requests[_next++];
+	_serviced++;
+
+	std::chrono::duration<float, std::milli> waited = _frame_start - request->_queued;
+	_latency_ms = std::max(_latency_ms, waited.count());
+
+	return true;
+}
+
+bool ga_terrain_scheduler::has_time() const
+{
+	if (_budget_ms <= 0.0f)
+	{
+		return true;
+	}
+
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - _frame_start;
+	return elapsed.count() + _charged_ms < _budget_ms;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Frame budgeted scheduling of terrain generation
+*/
+
+#include <chrono>
+#include <set>
+#include <vector>
+
+/*
+** A chunk waiting to be generated.
+** Lower priorities are serviced first.
+*/
+struct ga_terrain_request
+{
+	int _x;
+	int _z;
+	float _priority;
+	std::chrono::high_resolution_clock::time_point _queued;
+};
+
+/*
+** Queue of chunk requests serviced under a per-frame time budget.
+** Generation runs on workers, so the main thread's own time says little
+** about what a request costs; the caller charges each request's expected
+** worker time with charge() and that counts against the budget too.
+** Whatever doesn't fit in a frame's budget is carried over to the next
+** frame, keeping the time it was first requested so latency can be
+** reported.
+*/
+class ga_terrain_scheduler
+{
+public:
+	ga_terrain_scheduler();
+
+	// a budget of 0 ms or less services everything every frame
+	void set_budget(float milliseconds) { _budget_ms = milliseconds; }
+
+	/*
+	** Start timing a frame's work and make the queue match the chunks wanted
+	** now: new ones are queued, ones no longer wanted are dropped.
+	*/
+	void begin_frame(const std::set<std::pair<int, int> >& wanted);
+
+	/*
+	** Set priorities through get_requests(), then sort before servicing.
+	*/
+	std::vector<ga_terrain_request>& get_requests() { return _requests; }
+	void sort();
+
+	/*
+	** Take the next request if the frame has time left for it. At least one
+	** request is handed out every frame so the queue always drains.
+	*/
+	bool next(ga_terrain_request* request);
+
+	// count work done elsewhere for this frame against its budget
+	void charge(float milliseconds) { _charged_ms += milliseconds; }
+
+	// whether the frame's budget still has room for other work
+	bool has_time() const;
+
+	int get_queued() const { return (int) _requests.size() - _next; }
+
+	// longest a request serviced this frame had been waiting
+	float get_latency_ms() const { return _latency_ms; }
+
+private:
+	std::vector<ga_terrain_request> _requests;
+	int _next;
+
+	float _budget_ms;
+	std::chrono::high_resolution_clock::time_point _frame_start;
+	float _charged_ms;
+	int _serviced;
+	float _latency_ms;
+};
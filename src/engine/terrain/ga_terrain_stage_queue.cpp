@@ -0,0 +1,49 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Bounded queue between terrain pipeline stages
+*/
+#include "ga_terrain_stage_queue.h"
+
+ga_terrain_stage_queue::ga_terrain_stage_queue(int capacity) : _queue(capacity + 1)
+{
+	_reserved = 0;
+	_capacity = capacity;
+}
+
+bool ga_terrain_stage_queue::reserve()
+{
+	int reserved = _reserved;
+	do
+	{
+		if (reserved >= _capacity)
+		{
+			return false;
+		}
+	} while (!_reserved.compare_exchange_weak(reserved, reserved + 1));
+
+	return true;
+}
+
+bool ga_terrain_stage_queue::try_push(void* item)
+{
+	if (!reserve())
+	{
+		return false;
+	}
+
+	push_reserved(item);
+	return true;
+}
+
+bool ga_terrain_stage_queue::pop(void** item)
+{
+	if (!_queue.pop(item))
+	{
+		return false;
+	}
+
+	_reserved--;
+	return true;
+}
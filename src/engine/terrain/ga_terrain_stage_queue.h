@@ -0,0 +1,44 @@
+#pragma once
+
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Bounded queue between terrain pipeline stages
+*/
+
+#include "jobs/ga_queue.h"
+
+#include <atomic>
+
+/*
+** Lock-free queue of pipeline items with a fixed capacity.
+** Producers reserve a slot before doing the work that fills it, so a stage
+** whose output queue is full stops taking input instead of piling up
+** finished items: that's the pipeline's backpressure.
+*/
+class ga_terrain_stage_queue
+{
+public:
+	ga_terrain_stage_queue(int capacity);
+
+	/*
+	** Claim a slot for a later push_reserved(). Fails when full.
+	*/
+	bool reserve();
+	void unreserve() { _reserved--; }
+	void push_reserved(void* item) { _queue.push(item); }
+
+	bool try_push(void* item);
+	bool pop(void** item);
+
+	// items queued, plus slots reserved for items on their way
+	int get_count() const { return _reserved; }
+	int get_capacity() const { return _capacity; }
+
+private:
+	// one extra node for the queue's dummy
+	ga_queue _queue;
+	std::atomic_int _reserved;
+	int _capacity;
+};
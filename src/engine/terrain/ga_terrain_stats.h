@@ -0,0 +1,54 @@
+#pragma once
+
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Terrain streaming statistics
+*/
+
+/*
+** Counters describing the terrain streamer's work in the last frame.
+** Printed once a second when 'stats 1' is set in the terrain param file.
+*/
+struct ga_terrain_stats
+{
+	int _loaded;
+	int _drawn;
+	int _frustum_culled;
+	int _occlusion_culled;
+
+	// heightmap samples generated
+	int _generated;
+
+	// chunks left waiting for a later frame, and the longest wait of the
+	// chunks generated this frame
+	int _queued;
+	float _latency_ms;
+
+	// chunks through each pipeline stage since last frame, and how often a
+	// stage stopped because the queue after it was full
+	int _sampled;
+	int _meshed;
+	int _uploaded;
+	int _stalled;
+
+	// running totals: chunks that entered the radius already prefetched,
+	// chunks that entered it missing, and prefetched chunks dropped unused
+	int _prefetch_hits;
+	int _prefetch_misses;
+	int _prefetch_wasted;
+
+	// running totals of generation jobs dropped because their chunk left
+	// the wanted set, and the samples they had generated by then
+	int _cancelled;
+	int _cancelled_samples;
+
+	// chunks held compressed after leaving the radius, the bytes they take,
+	// and the chunks restored from them this frame with the average
+	// milliseconds decompressing one took
+	int _cached;
+	int _cached_bytes;
+	int _restored;
+	float _restore_ms;
+};
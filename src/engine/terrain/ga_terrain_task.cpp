@@ -0,0 +1,78 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Cancellable generation of a terrain chunk
+*/
+#include "ga_terrain_task.h"
+#include "ga_terrain_chunk.h"
+
+#include <chrono>
+
+ga_terrain_task::ga_terrain_task(int x, int z, ga_terrain_chunk* chunk, int preview_levels, bool prefetch)
+{
+	reset(x, z, chunk, preview_levels, prefetch);
+}
+
+ga_terrain_task::~ga_terrain_task()
+{
+	delete _chunk;
+}
+
+void ga_terrain_task::reset(int x, int z, ga_terrain_chunk* chunk, int preview_levels, bool prefetch)
+{
+	_x = x;
+	_z = z;
+	_chunk = chunk;
+	_preview_levels = preview_levels;
+	_prefetch = prefetch;
+
+	_cancelled = false;
+	_outdated = false;
+	_generated = 0;
+
+	// keeps its storage for the next compressed chunk
+	_cached.clear();
+	_decode_ms = 0.0f;
+	_work_ms = 0.0f;
+}
+
+void ga_terrain_task::run_noise()
+{
+	if (_cancelled)
+	{
+		return;
+	}
+
+	bool restored = false;
+	if (!_cached.empty())
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		restored = _chunk->decompress(_cached);
+		std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		_decode_ms = elapsed.count();
+	}
+
+	if (!restored)
+	{
+		_generated = _chunk->sample_preview(_preview_levels);
+	}
+}
+
+void ga_terrain_task::run_mesh()
+{
+	if (_cancelled)
+	{
+		return;
+	}
+
+	_chunk->build_bounds();
+	_chunk->build_mesh();
+}
+
+ga_terrain_chunk* ga_terrain_task::release_chunk()
+{
+	ga_terrain_chunk* chunk = _chunk;
+	_chunk = 0;
+	return chunk;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Cancellable generation of a terrain chunk
+*/
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/*
+** One chunk on its way through the streaming pipeline.
+** Each stage checks for cancellation before doing its work, so a chunk the
+** camera has already left stops costing work as soon as the streamer
+** notices. The task owns its chunk until the streamer takes it with
+** release_chunk(), and can be reset() to carry another one.
+** A task given a compressed heightmap through get_cached() decompresses it
+** in place of generating the chunk.
+*/
+class ga_terrain_task
+{
+public:
+	ga_terrain_task(int x, int z, class ga_terrain_chunk* chunk, int preview_levels, bool prefetch);
+	~ga_terrain_task();
+
+	void reset(int x, int z, class ga_terrain_chunk* chunk, int preview_levels, bool prefetch);
+
+	// sample or decompress the heightmap
+	void run_noise();
+
+	// bound the samples and build the mesh from them
+	void run_mesh();
+
+	// ask the remaining stages to skip their work
+	void cancel() { _cancelled = true; }
+	bool is_cancelled() const { return _cancelled; }
+
+	// the chunk was edited after its task started, so the heights it comes
+	// back with, and any compressed copy it was restored from, are stale;
+	// only the streamer reads or writes this
+	void set_outdated() { _outdated = true; }
+	bool is_outdated() const { return _outdated; }
+
+	int get_x() const { return _x; }
+	int get_z() const { return _z; }
+	bool is_prefetch() const { return _prefetch; }
+
+	// samples generated, whether or not the chunk was finished
+	int get_generated() const { return _generated; }
+
+	// compressed heightmap to restore the chunk from, if not empty, and the
+	// milliseconds decompressing it took
+	std::vector<uint8_t>& get_cached() { return _cached; }
+	float get_decode_ms() const { return _decode_ms; }
+
+	// milliseconds the workers have spent on the chunk, timed by the pipeline
+	void add_work_ms(float milliseconds) { _work_ms += milliseconds; }
+	float get_work_ms() const { return _work_ms; }
+
+	class ga_terrain_chunk* get_chunk() const { return _chunk; }
+	class ga_terrain_chunk* release_chunk();
+
+private:
+	int _x;
+	int _z;
+	class ga_terrain_chunk* _chunk;
+	int _preview_levels;
+	bool _prefetch;
+
+	std::atomic<bool> _cancelled;
+	bool _outdated;
+	int _generated;
+
+	std::vector<uint8_t> _cached;
+	float _decode_ms;
+	float _work_ms;
+};
@@ -0,0 +1,155 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Offline benchmark of batched frustum culling
+*/
+#include "framework/ga_cpu.h"
+#include "math/ga_frustum.h"
+#include "math/ga_mat4f.h"
+#include "math/ga_math.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+/*
+** Plain classification, a plane and a volume at a time, with the plane
+** distance summed left to right.
+*/
+static uint8_t _classify_reference(const ga_frustum& frustum, const ga_vec3f& center, const ga_vec3f& extent)
+{
+	bool inside = true;
+	for (int p = 0; p < 6; p++)
+	{
+		const ga_vec4f& plane = frustum.planes[p];
+		float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+		float radius = ga_absf(plane.x) * extent.x + ga_absf(plane.y) * extent.y + ga_absf(plane.z) * extent.z;
+		if (distance + radius < 0.0f)
+		{
+			return k_frustum_outside;
+		}
+		inside = inside && distance - radius >= 0.0f;
+	}
+	return inside ? k_frustum_inside : k_frustum_intersects;
+}
+
+static uint8_t _classify_sphere_reference(const ga_frustum& frustum, const ga_vec3f& center, float radius)
+{
+	bool inside = true;
+	for (int p = 0; p < 6; p++)
+	{
+		const ga_vec4f& plane = frustum.planes[p];
+		float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+		if (distance + radius < 0.0f)
+		{
+			return k_frustum_outside;
+		}
+		inside = inside && distance - radius >= 0.0f;
+	}
+	return inside ? k_frustum_inside : k_frustum_intersects;
+}
+
+static float _random()
+{
+	return (float) rand() / (float) RAND_MAX * 2.0f - 1.0f;
+}
+
+/*
+** Prints millions of volumes classified per second, one at a time and
+** batched, and how many batch results disagree with the reference.
+** Usage: ga_cull_bench [volume count] [milliseconds per measurement]
+** Set GA_CPU_TIER to measure the kernels of a lower tier.
+*/
+int main(int argc, const char** argv)
+{
+	int count = argc > 1 ? atoi(argv[1]) : 4096;
+	float milliseconds = argc > 2 ? (float) atof(argv[2]) : 200.0f;
+
+	// a camera over chunk sized volumes scattered all around it, so each
+	// class turns up often
+	ga_mat4f view, projection;
+	view.make_lookat_rh({ 0.0f, 10.0f, 0.0f }, { 30.0f, 0.0f, 20.0f }, { 0.0f, 1.0f, 0.0f });
+	projection.make_perspective_rh(ga_degrees_to_radians(60.0f), 16.0f / 9.0f, 0.1f, 200.0f);
+	ga_frustum frustum;
+	frustum.make_from_view_projection(view * projection);
+
+	std::vector<ga_aabb> boxes(count);
+	std::vector<ga_sphere> spheres(count);
+	ga_aabb_soa box_batch;
+	ga_sphere_soa sphere_batch;
+	for (int i = 0; i < count; i++)
+	{
+		ga_vec3f center = { _random() * 250.0f, _random() * 20.0f, _random() * 250.0f };
+		ga_vec3f extent = { 4.0f, 2.0f + _random(), 4.0f };
+		boxes[i] = { center - extent, center + extent };
+		spheres[i] = { center, 4.0f + _random() * 2.0f };
+		box_batch.push_back(boxes[i]);
+		sphere_batch.push_back(spheres[i]);
+	}
+
+	std::vector<uint8_t> results(count), expected(count);
+
+	auto measure = [&](const std::function<void()>& op)
+	{
+		int runs = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<float, std::milli> elapsed(0.0f);
+		while (elapsed.count() < milliseconds)
+		{
+			op();
+			runs++;
+			elapsed = std::chrono::high_resolution_clock::now() - start;
+		}
+		return (float) runs * count / (elapsed.count() * 1000.0f);
+	};
+
+	printf("cpu tier: %s\n", ga_cpu::get_tier_name(ga_cpu::get_tier()));
+	printf("%-10s %-14s %-14s %-14s %-8s %s\n", "volume", "reference M/s", "single M/s", "batch M/s", "speedup", "mismatches");
+
+	{
+		float reference = measure([&]() {
+			for (int i = 0; i < count; i++)
+			{
+				expected[i] = _classify_reference(frustum, boxes[i].get_center(), boxes[i].get_extent());
+			}
+		});
+		float single = measure([&]() {
+			for (int i = 0; i < count; i++) results[i] = (uint8_t) frustum.test_box(boxes[i]);
+		});
+		int mismatches = 0;
+		for (int i = 0; i < count; i++) mismatches += results[i] != expected[i];
+
+		float batch = measure([&]() { frustum.test_boxes(box_batch, &results[0]); });
+		for (int i = 0; i < count; i++) mismatches += results[i] != expected[i];
+
+		printf("%-10s %-14.1f %-14.1f %-14.1f %-8.2f %d\n", "box", reference, single, batch, batch / reference, mismatches);
+
+		int classes[3] = {};
+		for (int i = 0; i < count; i++) classes[expected[i]]++;
+		printf("%-10s %d outside, %d intersecting, %d inside\n", "", classes[0], classes[1], classes[2]);
+	}
+
+	{
+		float reference = measure([&]() {
+			for (int i = 0; i < count; i++)
+			{
+				expected[i] = _classify_sphere_reference(frustum, spheres[i].center, spheres[i].radius);
+			}
+		});
+		float single = measure([&]() {
+			for (int i = 0; i < count; i++) results[i] = (uint8_t) frustum.test_sphere(spheres[i]);
+		});
+		int mismatches = 0;
+		for (int i = 0; i < count; i++) mismatches += results[i] != expected[i];
+
+		float batch = measure([&]() { frustum.test_spheres(sphere_batch, &results[0]); });
+		for (int i = 0; i < count; i++) mismatches += results[i] != expected[i];
+
+		printf("%-10s %-14.1f %-14.1f %-14.1f %-8.2f %d\n", "sphere", reference, single, batch, batch / reference, mismatches);
+	}
+
+	return 0;
+}
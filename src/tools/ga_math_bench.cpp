@@ -0,0 +1,247 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Offline benchmark of ga_mat4f operations
+*/
+#include "framework/ga_cpu.h"
+#include "math/ga_mat4f.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+/*
+** The scalar operations ga_mat4f had before its SIMD paths.
+*/
+static ga_mat4f _multiply_reference(const ga_mat4f& a, const ga_mat4f& b)
+{
+	ga_mat4f result;
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int j = 0; j < 4; ++j)
+		{
+			float tmp = 0.0f;
+			for (int k = 0; k < 4; ++k)
+			{
+				tmp += a.data[i][k] * b.data[k][j];
+			}
+			result.data[i][j] = tmp;
+		}
+	}
+	return result;
+}
+
+static ga_vec3f _transform_point_reference(const ga_mat4f& m, const ga_vec3f& in)
+{
+	return {
+		in.x * m.data[0][0] + in.y * m.data[1][0] + in.z * m.data[2][0] + m.data[3][0],
+		in.x * m.data[0][1] + in.y * m.data[1][1] + in.z * m.data[2][1] + m.data[3][1],
+		in.x * m.data[0][2] + in.y * m.data[1][2] + in.z * m.data[2][2] + m.data[3][2],
+	};
+}
+
+static ga_mat4f _inverse_reference(const ga_mat4f& m)
+{
+	const float (*data)[4] = m.data;
+
+	float s[6];
+	s[0] = data[0][0] * data[1][1] - data[1][0] * data[0][1];
+	s[1] = data[0][0] * data[1][2] - data[1][0] * data[0][2];
+	s[2] = data[0][0] * data[1][3] - data[1][0] * data[0][3];
+	s[3] = data[0][1] * data[1][2] - data[1][1] * data[0][2];
+	s[4] = data[0][1] * data[1][3] - data[1][1] * data[0][3];
+	s[5] = data[0][2] * data[1][3] - data[1][2] * data[0][3];
+
+	float c[6];
+	c[0] = data[2][0] * data[3][1] - data[3][0] * data[2][1];
+	c[1] = data[2][0] * data[3][2] - data[3][0] * data[2][2];
+	c[2] = data[2][0] * data[3][3] - data[3][0] * data[2][3];
+	c[3] = data[2][1] * data[3][2] - data[3][1] * data[2][2];
+	c[4] = data[2][1] * data[3][3] - data[3][1] * data[2][3];
+	c[5] = data[2][2] * data[3][3] - data[3][2] * data[2][3];
+
+	float inv_det = 1.0f / (s[0] * c[5] - s[1] * c[4] + s[2] * c[3] + s[3] * c[2] - s[4] * c[1] + s[5] * c[0]);
+
+	ga_mat4f tmp;
+	tmp.data[0][0] = (data[1][1] * c[5] - data[1][2] * c[4] + data[1][3] * c[3])  * inv_det;
+	tmp.data[0][1] = (-data[0][1] * c[5] + data[0][2] * c[4] - data[0][3] * c[3]) * inv_det;
+	tmp.data[0][2] = (data[3][1] * s[5] - data[3][2] * s[4] + data[3][3] * s[3])  * inv_det;
+	tmp.data[0][3] = (-data[2][1] * s[5] + data[2][2] * s[4] - data[2][3] * s[3]) * inv_det;
+
+	tmp.data[1][0] = (-data[1][0] * c[5] + data[1][2] * c[2] - data[1][3] * c[1]) * inv_det;
+	tmp.data[1][1] = (data[0][0] * c[5] - data[0][2] * c[2] + data[0][3] * c[1])  * inv_det;
+	tmp.data[1][2] = (-data[3][0] * s[5] + data[3][2] * s[2] - data[3][3] * s[1]) * inv_det;
+	tmp.data[1][3] = (data[2][0] * s[5] - data[2][2] * s[2] + data[2][3] * s[1])  * inv_det;
+
+	tmp.data[2][0] = (data[1][0] * c[4] - data[1][1] * c[2] + data[1][3] * c[0])  * inv_det;
+	tmp.data[2][1] = (-data[0][0] * c[4] + data[0][1] * c[2] - data[0][3] * c[0]) * inv_det;
+	tmp.data[2][2] = (data[3][0] * s[4] - data[3][1] * s[2] + data[3][3] * s[0])  * inv_det;
+	tmp.data[2][3] = (-data[2][0] * s[4] + data[2][1] * s[2] - data[2][3] * s[0]) * inv_det;
+
+	tmp.data[3][0] = (-data[1][0] * c[3] + data[1][1] * c[1] - data[1][2] * c[0]) * inv_det;
+	tmp.data[3][1] = (data[0][0] * c[3] - data[0][1] * c[1] + data[0][2] * c[0])  * inv_det;
+	tmp.data[3][2] = (-data[3][0] * s[3] + data[3][1] * s[1] - data[3][2] * s[0]) * inv_det;
+	tmp.data[3][3] = (data[2][0] * s[3] - data[2][1] * s[1] + data[2][2] * s[0])  * inv_det;
+	return tmp;
+}
+
+// bounds of the eight transformed corners
+static void _transform_aabb_reference(const ga_mat4f& m, const ga_vec3f& min, const ga_vec3f& max,
+	ga_vec3f* out_min, ga_vec3f* out_max)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		ga_vec3f corner = { (i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z };
+		ga_vec3f p = _transform_point_reference(m, corner);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			out_min->axes[axis] = i == 0 ? p.axes[axis] : std::min(out_min->axes[axis], p.axes[axis]);
+			out_max->axes[axis] = i == 0 ? p.axes[axis] : std::max(out_max->axes[axis], p.axes[axis]);
+		}
+	}
+}
+
+static float _random()
+{
+	return (float) rand() / (float) RAND_MAX * 2.0f - 1.0f;
+}
+
+// largest difference relative to the magnitude of the expected values
+static float _error(const float* expected, const float* actual, int count)
+{
+	float error = 0.0f, magnitude = 1e-20f;
+	for (int i = 0; i < count; i++)
+	{
+		error = std::max(error, std::fabs(expected[i] - actual[i]));
+		magnitude = std::max(magnitude, std::fabs(expected[i]));
+	}
+	return error / magnitude;
+}
+
+/*
+** Prints millions of operations per second before and after, and the
+** relative error between them, for each ga_mat4f operation.
+** Usage: ga_math_bench [milliseconds per measurement]
+** Set GA_CPU_TIER to measure the kernels of a lower tier.
+*/
+int main(int argc, const char** argv)
+{
+	float milliseconds = argc > 1 ? (float) atof(argv[1]) : 200.0f;
+
+	const int k_count = 1024;
+
+	// a rigid transform with scale, as the engine's matrices mostly are
+	ga_mat4f m;
+	m.make_rotation({ 0.1f, 0.7f, -0.2f, 0.68f });
+	m.scale(1.5f);
+	m.set_translation({ 12.0f, -3.0f, 40.0f });
+
+	std::vector<ga_mat4f> matrices(k_count);
+	std::vector<ga_vec3f> points(k_count), mins(k_count), maxs(k_count);
+	for (int i = 0; i < k_count; i++)
+	{
+		for (int j = 0; j < 16; j++)
+		{
+			matrices[i].data[j / 4][j % 4] = _random();
+		}
+		points[i] = { _random() * 100.0f, _random() * 100.0f, _random() * 100.0f };
+		mins[i] = points[i];
+		maxs[i] = points[i] + ga_vec3f{ 8.0f, _random() * 4.0f + 4.0f, 8.0f };
+	}
+
+	std::vector<ga_mat4f> products(k_count), expected_products(k_count);
+	std::vector<ga_vec3f> transformed(k_count), expected_transformed(k_count);
+	std::vector<ga_vec3f> out_mins(k_count), out_maxs(k_count);
+	std::vector<ga_vec3f> expected_mins(k_count), expected_maxs(k_count);
+
+	// runs op over the whole batch until the time is up
+	auto measure = [&](const std::function<void()>& op)
+	{
+		int runs = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<float, std::milli> elapsed(0.0f);
+		while (elapsed.count() < milliseconds)
+		{
+			op();
+			runs++;
+			elapsed = std::chrono::high_resolution_clock::now() - start;
+		}
+		return (float) runs * k_count / (elapsed.count() * 1000.0f);
+	};
+
+	printf("cpu tier: %s\n", ga_cpu::get_tier_name(ga_cpu::get_tier()));
+	printf("%-18s %-14s %-14s %-8s %s\n", "operation", "before Mop/s", "after Mop/s", "speedup", "rel error");
+
+	auto report = [](const char* name, float before, float after, float error)
+	{
+		printf("%-18s %-14.1f %-14.1f %-8.2f %g\n", name, before, after, after / before, error);
+	};
+
+	{
+		float before = measure([&]() {
+			for (int i = 0; i < k_count; i++) expected_products[i] = _multiply_reference(matrices[i], m);
+		});
+		float after = measure([&]() {
+			for (int i = 0; i < k_count; i++) products[i] = matrices[i] * m;
+		});
+		report("multiply", before, after,
+			_error(&expected_products[0].data[0][0], &products[0].data[0][0], k_count * 16));
+	}
+
+	{
+		float before = measure([&]() {
+			for (int i = 0; i < k_count; i++) expected_products[i] = _inverse_reference(matrices[i]);
+		});
+		float after = measure([&]() {
+			for (int i = 0; i < k_count; i++) products[i] = matrices[i].inverse();
+		});
+
+		// random matrices can be badly conditioned, so compare each on its own scale
+		float error = 0.0f;
+		for (int i = 0; i < k_count; i++)
+		{
+			error = std::max(error, _error(&expected_products[i].data[0][0], &products[i].data[0][0], 16));
+		}
+		report("inverse", before, after, error);
+	}
+
+	{
+		float before = measure([&]() {
+			for (int i = 0; i < k_count; i++) expected_transformed[i] = _transform_point_reference(m, points[i]);
+		});
+		float single = measure([&]() {
+			for (int i = 0; i < k_count; i++) transformed[i] = m.transform_point(points[i]);
+		});
+		report("transform_point", before, single,
+			_error(&expected_transformed[0].x, &transformed[0].x, k_count * 3));
+
+		float batch = measure([&]() {
+			m.transform_points(&points[0], &transformed[0], k_count);
+		});
+		report("transform_points", before, batch,
+			_error(&expected_transformed[0].x, &transformed[0].x, k_count * 3));
+	}
+
+	{
+		float before = measure([&]() {
+			for (int i = 0; i < k_count; i++)
+			{
+				_transform_aabb_reference(m, mins[i], maxs[i], &expected_mins[i], &expected_maxs[i]);
+			}
+		});
+		float after = measure([&]() {
+			m.transform_aabbs(&mins[0], &maxs[0], &out_mins[0], &out_maxs[0], k_count);
+		});
+		float error = std::max(
+			_error(&expected_mins[0].x, &out_mins[0].x, k_count * 3),
+			_error(&expected_maxs[0].x, &out_maxs[0].x, k_count * 3));
+		report("transform_aabbs", before, after, error);
+	}
+
+	return 0;
+}
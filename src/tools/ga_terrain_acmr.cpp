@@ -0,0 +1,57 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Offline report of vertex cache efficiency for terrain index orderings
+*/
+#include "terrain/ga_terrain_mesh.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+/*
+** Prints the average cache miss ratio of every index ordering for each chunk
+** detail level, so the terrain param file's index_order can be picked per
+** grid size. Usage: ga_terrain_acmr [cache size...]
+*/
+int main(int argc, const char** argv)
+{
+	int cache_sizes[8] = { 16, 32 };
+	int cache_count = 2;
+	if (argc > 1)
+	{
+		cache_count = 0;
+		for (int i = 1; i < argc && cache_count < 8; i++)
+		{
+			cache_sizes[cache_count++] = atoi(argv[i]);
+		}
+	}
+
+	printf("%-8s %-8s", "detail", "order");
+	for (int c = 0; c < cache_count; c++)
+	{
+		printf("  acmr@%-4d", cache_sizes[c]);
+	}
+	printf("\n");
+
+	// measured with 32-bit indices so grids past detail 7 can be compared too
+	std::vector<uint32_t> indices;
+	for (int detail = 2; detail <= 9; detail++)
+	{
+		int size = (1 << detail) + 1;
+		for (int order = k_index_order_rows; order <= k_index_order_strips; order++)
+		{
+			ga_terrain_index_order o = (ga_terrain_index_order) order;
+			ga_terrain_mesh::build_indices(o, size, indices);
+
+			printf("%-8d %-8s", detail, ga_terrain_mesh::get_index_order_name(o));
+			for (int c = 0; c < cache_count; c++)
+			{
+				printf("  %-9.3f", ga_terrain_mesh::compute_acmr(indices, ga_terrain_mesh::is_strip(o), cache_sizes[c]));
+			}
+			printf("\n");
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,264 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Offline benchmark of hydraulic and thermal erosion
+*/
+#include "framework/ga_cpu.h"
+#include "jobs/ga_job.h"
+#include "terrain/ga_terrain_erosion.h"
+#include "terrain/ga_terrain_field.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// the field loads its param file relative to this
+char g_root_path[256] = "";
+
+/*
+** Chunk (x, z)'s heightmap, sampled the way chunks sample it.
+*/
+static void _sample_chunk(const ga_terrain_field* field, int x, int z, std::vector<float>& heights)
+{
+	const ga_terrain_params& params = field->get_params();
+	int size = params._size;
+	float cell = params._width / (float) (size - 1);
+
+	std::vector<float> row_x(size);
+	std::vector<float> row_z(size);
+	heights.resize(size * size);
+	for (int j = 0; j < size; j++)
+	{
+		for (int i = 0; i < size; i++)
+		{
+			row_x[i] = x * params._width + ((float) i * cell - params._width * 0.5f);
+			row_z[i] = z * params._width + ((float) j * cell - params._width * 0.5f);
+		}
+		field->get_samples(&row_x[0], &row_z[0], &heights[j * size], size);
+	}
+}
+
+/*
+** Every tile one after another, as a single core would.
+*/
+static void _erode_serial(const std::vector<ga_terrain_erosion_tile>& tiles)
+{
+	for (const ga_terrain_erosion_tile& tile : tiles)
+	{
+		ga_terrain_erosion::erode_tile(tile);
+	}
+}
+
+/*
+** Each pass's tiles as jobs, the way the streaming pipeline runs them.
+*/
+static void _erode_parallel(const std::vector<ga_terrain_erosion_tile>& tiles)
+{
+	std::vector<ga_job_decl_t> decls;
+	size_t first = 0;
+	while (first < tiles.size())
+	{
+		decls.clear();
+		for (size_t t = first; t < tiles.size() && tiles[t]._pass == tiles[first]._pass; t++)
+		{
+			ga_job_decl_t decl;
+			decl._data = (void*) &tiles[t];
+			decl._entry = [](void* data)
+			{
+				ga_terrain_erosion::erode_tile(*static_cast<const ga_terrain_erosion_tile*>(data));
+			};
+			decls.push_back(decl);
+		}
+
+		int32_t counter;
+		ga_job::run(&decls[0], (int) decls.size(), &counter);
+		ga_job::wait(&counter);
+		first += decls.size();
+	}
+}
+
+/*
+** Thermal erosion as a plain loop, one sample at a time.
+*/
+static void _relax_reference(std::vector<float>& heights, int size, int iterations, float talus)
+{
+	std::vector<float> next(heights);
+	for (int it = 0; it < iterations; it++)
+	{
+		for (int j = 1; j < size - 1; j++)
+		{
+			for (int i = 1; i < size - 1; i++)
+			{
+				const float* h = &heights[j * size + i];
+				int neighbors[4] = { -1, 1, -size, size };
+				float flow = 0.0f;
+				for (int n = 0; n < 4; n++)
+				{
+					float in = (h[neighbors[n]] - h[0]) - talus;
+					float out = (h[0] - h[neighbors[n]]) - talus;
+					flow = flow + ((in > 0.0f ? in : 0.0f) - (out > 0.0f ? out : 0.0f));
+				}
+				next[j * size + i] = h[0] + 0.125f * flow;
+			}
+		}
+		heights.swap(next);
+	}
+}
+
+/*
+** Prints hydraulic erosion throughput of a chunk run serially and on the
+** job system for several tile sizes, and checks both give the same
+** heightmap with its edges untouched. Then prints thermal erosion
+** throughput against a plain loop, and checks they match.
+** Set GA_CPU_TIER to measure the thermal kernels of a lower tier.
+** Usage: ga_terrain_erosion_bench <terrain param file> [droplets per sample] [milliseconds per measurement]
+*/
+int main(int argc, const char** argv)
+{
+	if (argc < 2)
+	{
+		printf("usage: ga_terrain_erosion_bench <terrain param file> [droplets per sample] [milliseconds]\n");
+		return 1;
+	}
+
+	ga_cpu::startup();
+	ga_job::startup(0xffff, 256, 256);
+
+	ga_terrain_field field(argv[1]);
+	const ga_terrain_params& params = field.get_params();
+	float droplets = argc > 2 ? (float) atof(argv[2]) : 0.25f;
+	float milliseconds = argc > 3 ? (float) atof(argv[3]) : 500.0f;
+
+	int size = params._size;
+	float height_scale = (float) params._height / params._width;
+
+	std::vector<float> original;
+	_sample_chunk(&field, 3, -2, original);
+
+	printf("chunk %dx%d, %g droplets per sample\n", size, size, droplets);
+	printf("%-6s %-6s %-16s %-16s %-8s %-10s %-10s %s\n", "tile", "tiles", "serial kdrops/s", "jobs kdrops/s",
+		"speedup", "mismatch", "edge diff", "max change");
+
+	for (int tile_size = 8; tile_size < 2 * (size - 1) && tile_size <= 256; tile_size *= 2)
+	{
+		std::vector<float> serial(original);
+		std::vector<float> parallel(original);
+		std::vector<ga_terrain_erosion_tile> serial_tiles;
+		std::vector<ga_terrain_erosion_tile> parallel_tiles;
+		ga_terrain_erosion::build_tiles(&serial[0], size, 3, -2, params._seed, droplets, tile_size, height_scale, serial_tiles);
+		ga_terrain_erosion::build_tiles(&parallel[0], size, 3, -2, params._seed, droplets, tile_size, height_scale, parallel_tiles);
+
+		int total = 0;
+		for (const ga_terrain_erosion_tile& tile : serial_tiles)
+		{
+			total += tile._droplets;
+		}
+
+		auto measure = [&](std::vector<float>& heights, const std::vector<ga_terrain_erosion_tile>& tiles, bool jobs)
+		{
+			int runs = 0;
+			std::chrono::duration<float, std::milli> elapsed(0.0f);
+			while (elapsed.count() < milliseconds)
+			{
+				// erode the same chunk each time, leaving the result of the last run
+				memcpy(&heights[0], &original[0], original.size() * sizeof(float));
+				auto start = std::chrono::high_resolution_clock::now();
+				if (jobs)
+				{
+					_erode_parallel(tiles);
+				}
+				else
+				{
+					_erode_serial(tiles);
+				}
+				elapsed += std::chrono::high_resolution_clock::now() - start;
+				runs++;
+			}
+			return (float) runs * total / elapsed.count();
+		};
+
+		float serial_rate = measure(serial, serial_tiles, false);
+		float parallel_rate = measure(parallel, parallel_tiles, true);
+
+		int mismatches = 0;
+		float change = 0.0f;
+		for (size_t s = 0; s < original.size(); s++)
+		{
+			mismatches += serial[s] != parallel[s] ? 1 : 0;
+			change = std::fmax(change, std::fabs(serial[s] - original[s]));
+		}
+
+		float edge = 0.0f;
+		for (int k = 0; k < size; k++)
+		{
+			int indices[4] = { k, (size - 1) * size + k, k * size, k * size + size - 1 };
+			for (int index : indices)
+			{
+				edge = std::fmax(edge, std::fabs(parallel[index] - original[index]));
+			}
+		}
+
+		printf("%-6d %-6d %-16.1f %-16.1f %-8.2f %-10d %-10g %g\n", tile_size, (int) serial_tiles.size(),
+			serial_rate, parallel_rate, parallel_rate / serial_rate, mismatches, edge, change);
+	}
+
+	// a steep talus, so most of the chunk moves
+	float talus = std::tan(30.0f * 3.14159265f / 180.0f) * (params._width / (float) (size - 1)) / (float) params._height;
+
+	printf("\nthermal erosion, cpu tier %s\n", ga_cpu::get_tier_name(ga_cpu::get_tier()));
+	printf("%-10s %-16s %-16s %-8s %-10s %s\n", "iters", "before Ms/s", "after Ms/s", "speedup", "mismatch", "mass drift");
+
+	for (int iterations = 4; iterations <= 64; iterations *= 4)
+	{
+		std::vector<float> expected(original);
+		std::vector<float> relaxed(original);
+		std::vector<float> scratch(original.size());
+
+		auto measure = [&](bool reference)
+		{
+			int runs = 0;
+			std::chrono::duration<float, std::milli> elapsed(0.0f);
+			while (elapsed.count() < milliseconds)
+			{
+				std::vector<float>& heights = reference ? expected : relaxed;
+				memcpy(&heights[0], &original[0], original.size() * sizeof(float));
+				auto start = std::chrono::high_resolution_clock::now();
+				if (reference)
+				{
+					_relax_reference(heights, size, iterations, talus);
+				}
+				else
+				{
+					ga_terrain_erosion::relax(&heights[0], &scratch[0], size, iterations, talus);
+				}
+				elapsed += std::chrono::high_resolution_clock::now() - start;
+				runs++;
+			}
+			return (float) runs * iterations * size * size / (elapsed.count() * 1000.0f);
+		};
+
+		float before = measure(true);
+		float after = measure(false);
+
+		// material only moves, short of what crosses the fixed edges
+		int mismatches = 0;
+		double before_mass = 0.0;
+		double after_mass = 0.0;
+		for (size_t s = 0; s < original.size(); s++)
+		{
+			mismatches += expected[s] != relaxed[s] ? 1 : 0;
+			before_mass += original[s];
+			after_mass += relaxed[s];
+		}
+
+		printf("%-10d %-16.1f %-16.1f %-8.2f %-10d %g\n", iterations, before, after, after / before,
+			mismatches, (after_mass - before_mass) / before_mass);
+	}
+
+	ga_job::shutdown();
+	return 0;
+}
@@ -0,0 +1,262 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Offline benchmark of flow accumulation over a block of chunks
+*/
+#include "framework/ga_cpu.h"
+#include "jobs/ga_job.h"
+#include "terrain/ga_terrain_chunk.h"
+#include "terrain/ga_terrain_field.h"
+#include "terrain/ga_terrain_flow.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// the field loads its param file relative to this
+char g_root_path[256] = "";
+
+/*
+** D8 over the whole block at once, one sample at a time from the highest
+** down. Samples of missing chunks are left out, the way the flow leaves
+** out chunks that aren't loaded.
+*/
+static void _route_reference(const std::vector<float>& heights, const std::vector<bool>& loaded, int side,
+	std::vector<uint8_t>& directions, std::vector<uint32_t>& accumulation)
+{
+	const int offset_x[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+	const int offset_z[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+
+	directions.assign(side * side, 0);
+	accumulation.assign(side * side, 0);
+	std::vector<int> order;
+	for (int j = 0; j < side; j++)
+	{
+		for (int i = 0; i < side; i++)
+		{
+			int k = j * side + i;
+			if (!loaded[k])
+			{
+				continue;
+			}
+
+			uint8_t direction = 8;
+			float steepest = 0.0f;
+			bool missing = false;
+			for (int d = 0; d < 8; d++)
+			{
+				int ni = i + offset_x[d];
+				int nj = j + offset_z[d];
+				if (ni < 0 || ni >= side || nj < 0 || nj >= side || !loaded[nj * side + ni])
+				{
+					missing = true;
+					continue;
+				}
+
+				float distance = offset_x[d] != 0 && offset_z[d] != 0 ? 0.70710678f : 1.0f;
+				float slope = (heights[k] - heights[nj * side + ni]) * distance;
+				if (slope > steepest)
+				{
+					steepest = slope;
+					direction = (uint8_t) d;
+				}
+			}
+			directions[k] = direction == 8 && missing ? 9 : direction;
+			accumulation[k] = 1;
+			order.push_back(k);
+		}
+	}
+
+	// flow only goes downhill, so everything above a sample comes before it
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return heights[a] > heights[b]; });
+	for (int k : order)
+	{
+		if (directions[k] < 8)
+		{
+			int target = (k / side + offset_z[directions[k]]) * side + k % side + offset_x[directions[k]];
+			accumulation[target] += accumulation[k];
+		}
+	}
+}
+
+/*
+** Each tile's stage as a job, the way the component runs them.
+*/
+static void _run_stage(ga_terrain_flow* flow, int tile_count, ga_job_function_t entry)
+{
+	std::vector<std::pair<ga_terrain_flow*, int> > tiles(tile_count);
+	std::vector<ga_job_decl_t> decls(tile_count);
+	for (int t = 0; t < tile_count; t++)
+	{
+		tiles[t] = std::make_pair(flow, t);
+		decls[t]._data = &tiles[t];
+		decls[t]._entry = entry;
+	}
+
+	int32_t counter;
+	ga_job::run(&decls[0], tile_count, &counter);
+	ga_job::wait(&counter);
+}
+
+static void _compute_flow(ga_terrain_flow* flow, const std::vector<ga_terrain_chunk*>& chunks, bool jobs)
+{
+	int tile_count = flow->begin(chunks);
+	if (!jobs)
+	{
+		for (int t = 0; t < tile_count; t++)
+		{
+			flow->route_tile(t);
+		}
+		flow->stitch();
+		for (int t = 0; t < tile_count; t++)
+		{
+			flow->finish_tile(t);
+		}
+		return;
+	}
+
+	_run_stage(flow, tile_count, [](void* data)
+	{
+		auto tile = static_cast<std::pair<ga_terrain_flow*, int>*>(data);
+		tile->first->route_tile(tile->second);
+	});
+	flow->stitch();
+	_run_stage(flow, tile_count, [](void* data)
+	{
+		auto tile = static_cast<std::pair<ga_terrain_flow*, int>*>(data);
+		tile->first->finish_tile(tile->second);
+	});
+}
+
+/*
+** Prints samples per second of flow over a block of chunks routed as one
+** grid, tile by tile on one thread, and tile by tile on the job system,
+** and checks the tiled accumulation matches the whole-block one. A few
+** chunks are left out so flow also has to find its way around holes.
+** Usage: ga_terrain_flow_bench <terrain param file> [chunks per side] [milliseconds per measurement]
+*/
+int main(int argc, const char** argv)
+{
+	if (argc < 2)
+	{
+		printf("usage: ga_terrain_flow_bench <terrain param file> [chunks per side] [milliseconds]\n");
+		return 1;
+	}
+
+	ga_cpu::startup();
+	ga_job::startup(0xffff, 256, 256);
+
+	ga_terrain_field field(argv[1]);
+	const ga_terrain_params& params = field.get_params();
+	int side_chunks = argc > 2 ? atoi(argv[2]) : 6;
+	float milliseconds = argc > 3 ? (float) atof(argv[3]) : 500.0f;
+
+	int size = params._size;
+	int cells = size - 1;
+	int side = side_chunks * cells;
+
+	// a block away from the origin, missing one chunk inside and one corner
+	const int k_first_x = -2;
+	const int k_first_z = 5;
+	std::vector<ga_terrain_chunk*> chunks;
+	std::vector<float> heights(side * side, 0.0f);
+	std::vector<bool> loaded(side * side, false);
+	for (int z = 0; z < side_chunks; z++)
+	{
+		for (int x = 0; x < side_chunks; x++)
+		{
+			if ((x == side_chunks / 2 && z == side_chunks / 2) || (x == side_chunks - 1 && z == 0))
+			{
+				continue;
+			}
+
+			ga_terrain_chunk* chunk = new ga_terrain_chunk(&field, k_first_x + x, k_first_z + z);
+			chunk->generate();
+			chunks.push_back(chunk);
+
+			for (int j = 0; j < cells; j++)
+			{
+				for (int i = 0; i < cells; i++)
+				{
+					int k = (z * cells + j) * side + x * cells + i;
+					heights[k] = chunk->get_heights()[j * size + i];
+					loaded[k] = true;
+				}
+			}
+		}
+	}
+
+	ga_terrain_flow flow(&field);
+
+	auto measure = [&](int mode)
+	{
+		std::vector<uint8_t> directions;
+		std::vector<uint32_t> accumulation;
+		int runs = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<float, std::milli> elapsed(0.0f);
+		while (elapsed.count() < milliseconds)
+		{
+			if (mode == 0)
+			{
+				_route_reference(heights, loaded, side, directions, accumulation);
+			}
+			else
+			{
+				_compute_flow(&flow, chunks, mode == 2);
+			}
+			runs++;
+			elapsed = std::chrono::high_resolution_clock::now() - start;
+		}
+		return (float) runs * chunks.size() * cells * cells / (elapsed.count() * 1000.0f);
+	};
+
+	float reference_rate = measure(0);
+	float serial_rate = measure(1);
+	float parallel_rate = measure(2);
+
+	std::vector<uint8_t> directions;
+	std::vector<uint32_t> expected;
+	_route_reference(heights, loaded, side, directions, expected);
+
+	// the tiled flow, read back at each sample's world position
+	float cell = params._width / (float) cells;
+	int mismatches = 0;
+	uint32_t largest = 0;
+	for (int j = 0; j < side; j++)
+	{
+		for (int i = 0; i < side; i++)
+		{
+			int k = j * side + i;
+			if (!loaded[k])
+			{
+				continue;
+			}
+
+			float x = (float) (k_first_x * cells + i - cells / 2) * cell;
+			float z = (float) (k_first_z * cells + j - cells / 2) * cell;
+			mismatches += flow.get_accumulation(x, z) != expected[k] ? 1 : 0;
+			largest = std::max(largest, expected[k]);
+		}
+	}
+
+	std::vector<ga_vec3f> rivers;
+	std::vector<ga_vec3f> lakes;
+	flow.extract_rivers(std::max(largest / 64, 2u), rivers, lakes);
+
+	printf("%d chunks of %dx%d samples\n", (int) chunks.size(), cells, cells);
+	printf("%-16s %-16s %-16s %-10s %-10s %s\n", "global Ms/s", "tiled Ms/s", "jobs Ms/s", "mismatch", "largest", "rivers/lakes");
+	printf("%-16.2f %-16.2f %-16.2f %-10d %-10u %d/%d\n", reference_rate, serial_rate, parallel_rate,
+		mismatches, largest, (int) rivers.size(), (int) lakes.size());
+
+	for (ga_terrain_chunk* chunk : chunks)
+	{
+		delete chunk;
+	}
+
+	ga_job::shutdown();
+	return 0;
+}
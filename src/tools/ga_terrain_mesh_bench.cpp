@@ -0,0 +1,124 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Offline benchmark of terrain chunk mesh building
+*/
+#include "framework/ga_cpu.h"
+#include "terrain/ga_terrain_mesh.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+/*
+** The mesh building chunks did before build_vertices: a push_back per
+** vertex with the position recomputed from the sample coordinates, and the
+** index buffer rebuilt for every chunk.
+*/
+static void _build_mesh_reference(const float* samples, int size, float center_x, float center_z,
+	float width, float scale, float offset, std::vector<ga_vec3f>& vertices, std::vector<uint32_t>& indices)
+{
+	vertices.clear();
+	for (int i = 0; i < size; i++)
+	{
+		for (int j = 0; j < size; j++)
+		{
+			float x = width * ((float) i / (float) (size - 1) - 0.5f) + center_x;
+			float z = width * ((float) j / (float) (size - 1) - 0.5f) + center_z;
+			float y = samples[j * size + i] * scale + offset;
+
+			vertices.push_back({ x, y, z });
+		}
+	}
+
+	ga_terrain_mesh::build_indices(k_index_order_morton, size, indices);
+}
+
+/*
+** Kernel and template copy, into buffers already sized for the grid.
+*/
+static void _build_mesh(const float* samples, int size, float center_x, float center_z,
+	float width, float scale, float offset, std::vector<ga_vec3f>& vertices,
+	const std::vector<uint32_t>& indices_template, std::vector<uint32_t>& indices)
+{
+	vertices.resize(size * size);
+	ga_terrain_mesh::build_vertices(samples, size, 1, center_x, center_z, width, scale, offset, &vertices[0]);
+	indices.assign(indices_template.begin(), indices_template.end());
+}
+
+/*
+** Prints vertices per second of the old and new chunk mesh building for
+** each detail level, and checks they build the same mesh.
+** Usage: ga_terrain_mesh_bench [milliseconds per measurement]
+** Set GA_CPU_TIER to measure the kernels of a lower tier.
+*/
+int main(int argc, const char** argv)
+{
+	float milliseconds = argc > 1 ? (float) atof(argv[1]) : 200.0f;
+
+	printf("cpu tier: %s\n", ga_cpu::get_tier_name(ga_cpu::get_tier()));
+	printf("%-8s %-14s %-14s %-8s %s\n", "detail", "before Mv/s", "after Mv/s", "speedup", "max error");
+
+	for (int detail = 2; detail <= 9; detail++)
+	{
+		int size = (1 << detail) + 1;
+
+		std::vector<float> samples(size * size);
+		for (float& s : samples)
+		{
+			s = (float) rand() / (float) RAND_MAX;
+		}
+
+		// a chunk away from the origin, as most are
+		const float k_width = 8.0f;
+		float center_x = 13.0f * k_width;
+		float center_z = -7.0f * k_width;
+
+		std::vector<ga_vec3f> vertices;
+		std::vector<uint32_t> indices;
+		std::vector<uint32_t> indices_template;
+		ga_terrain_mesh::build_indices(k_index_order_morton, size, indices_template);
+
+		auto measure = [&](bool reference)
+		{
+			int runs = 0;
+			auto start = std::chrono::high_resolution_clock::now();
+			std::chrono::duration<float, std::milli> elapsed(0.0f);
+			while (elapsed.count() < milliseconds)
+			{
+				if (reference)
+				{
+					// chunks used to start each mesh from empty buffers
+					std::vector<ga_vec3f>().swap(vertices);
+					std::vector<uint32_t>().swap(indices);
+					_build_mesh_reference(&samples[0], size, center_x, center_z, k_width, 3.0f, -1.5f, vertices, indices);
+				}
+				else
+				{
+					_build_mesh(&samples[0], size, center_x, center_z, k_width, 3.0f, -1.5f, vertices, indices_template, indices);
+				}
+				runs++;
+				elapsed = std::chrono::high_resolution_clock::now() - start;
+			}
+			return (float) runs * size * size / (elapsed.count() * 1000.0f);
+		};
+
+		float before = measure(true);
+		std::vector<ga_vec3f> expected = vertices;
+		float after = measure(false);
+
+		float error = 0.0f;
+		for (size_t v = 0; v < expected.size(); v++)
+		{
+			error = std::fmax(error, std::fabs(expected[v].x - vertices[v].x));
+			error = std::fmax(error, std::fabs(expected[v].y - vertices[v].y));
+			error = std::fmax(error, std::fabs(expected[v].z - vertices[v].z));
+		}
+
+		printf("%-8d %-14.1f %-14.1f %-8.2f %g\n", detail, before, after, after / before, error);
+	}
+
+	return 0;
+}
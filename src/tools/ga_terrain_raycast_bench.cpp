@@ -0,0 +1,193 @@
+/*
+** RPI Game Architecture 2017
+** Final project - Ian Chamberlain
+**
+** Offline benchmark of ray casts against loaded terrain chunks
+*/
+#include "framework/ga_cpu.h"
+#include "jobs/ga_job.h"
+#include "terrain/ga_terrain_chunk.h"
+#include "terrain/ga_terrain_chunk_grid.h"
+#include "terrain/ga_terrain_field.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// the field loads its param file relative to this
+char g_root_path[256] = "";
+
+struct ray_batch_t
+{
+	const ga_terrain_chunk_grid* _grid;
+	const ga_vec3f* _origins;
+	const ga_vec3f* _dirs;
+	uint8_t* _hits;
+	float* _t;
+	int _count;
+	float _width;
+	float _max_distance;
+};
+
+static void _cast_rays(const ray_batch_t& batch)
+{
+	for (int r = 0; r < batch._count; r++)
+	{
+		batch._hits[r] = batch._grid->raycast(batch._origins[r], batch._dirs[r], batch._width, batch._max_distance, &batch._t[r]) ? 1 : 0;
+	}
+}
+
+/*
+** The rays split into jobs the way ga_terrain_component's batched raycast
+** splits them: at most 64 jobs of at least 64 rays.
+*/
+static void _cast_rays_parallel(const ray_batch_t& rays)
+{
+	const int k_min_rays = 64;
+	const int k_max_jobs = 64;
+
+	int job_count = (rays._count + k_min_rays - 1) / k_min_rays;
+	job_count = job_count > k_max_jobs ? k_max_jobs : job_count;
+	if (job_count <= 1)
+	{
+		_cast_rays(rays);
+		return;
+	}
+
+	std::vector<ga_job_decl_t> decls(job_count);
+	std::vector<ray_batch_t> batches(job_count, rays);
+
+	int rays_per_job = (rays._count + job_count - 1) / job_count;
+	for (int i = 0; i < job_count; i++)
+	{
+		int start = i * rays_per_job;
+		int end = start + rays_per_job > rays._count ? rays._count : start + rays_per_job;
+
+		batches[i]._origins += start;
+		batches[i]._dirs += start;
+		batches[i]._hits += start;
+		batches[i]._t += start;
+		batches[i]._count = end > start ? end - start : 0;
+
+		decls[i]._data = &batches[i];
+		decls[i]._entry = [](void* data)
+		{
+			_cast_rays(*static_cast<ray_batch_t*>(data));
+		};
+	}
+
+	int32_t counter;
+	ga_job::run(&decls[0], job_count, &counter);
+	ga_job::wait(&counter);
+}
+
+/*
+** Prints rays per second cast one at a time and in batches on the job
+** system against a square of loaded chunks, and checks the batches hit
+** exactly where the single rays do.
+** Usage: ga_terrain_raycast_bench <terrain param file> [rays] [milliseconds per measurement]
+*/
+int main(int argc, const char** argv)
+{
+	if (argc < 2)
+	{
+		printf("usage: ga_terrain_raycast_bench <terrain param file> [rays] [milliseconds]\n");
+		return 1;
+	}
+
+	ga_cpu::startup();
+	ga_job::startup(0xffff, 256, 256);
+
+	ga_terrain_field field(argv[1]);
+	const ga_terrain_params& params = field.get_params();
+	int ray_count = argc > 2 ? atoi(argv[2]) : 16384;
+	float milliseconds = argc > 3 ? (float) atof(argv[3]) : 500.0f;
+
+	// every chunk within the radius, as the streamer keeps them
+	ga_terrain_chunk_grid grid(params._radius);
+	std::vector<ga_terrain_chunk*> chunks;
+	for (int z = -params._radius; z <= params._radius; z++)
+	{
+		for (int x = -params._radius; x <= params._radius; x++)
+		{
+			ga_terrain_chunk* chunk = new ga_terrain_chunk(&field, x, z);
+			chunk->generate();
+			grid.insert(x, z, chunk);
+			chunks.push_back(chunk);
+		}
+	}
+
+	// picking-like rays from above the terrain, pointing down at all angles
+	float extent = params._radius * params._width;
+	float max_distance = 2.0f * extent;
+	std::vector<ga_vec3f> origins(ray_count);
+	std::vector<ga_vec3f> dirs(ray_count);
+	for (int r = 0; r < ray_count; r++)
+	{
+		float x = ((float) rand() / (float) RAND_MAX - 0.5f) * extent;
+		float z = ((float) rand() / (float) RAND_MAX - 0.5f) * extent;
+		origins[r] = { x, (float) params._height, z };
+
+		float angle = (float) rand() / (float) RAND_MAX * 6.2831853f;
+		float down = 0.05f + (float) rand() / (float) RAND_MAX;
+		ga_vec3f dir = { std::cos(angle), -down, std::sin(angle) };
+		dirs[r] = dir.scale_result(1.0f / std::sqrt(dir.dot(dir)));
+	}
+
+	std::vector<uint8_t> single_hits(ray_count);
+	std::vector<uint8_t> batch_hits(ray_count);
+	std::vector<float> single_t(ray_count);
+	std::vector<float> batch_t(ray_count);
+
+	auto measure = [&](bool jobs)
+	{
+		std::vector<uint8_t>& hits = jobs ? batch_hits : single_hits;
+		std::vector<float>& t = jobs ? batch_t : single_t;
+		ray_batch_t rays = { &grid, &origins[0], &dirs[0], &hits[0], &t[0], ray_count, params._width, max_distance };
+
+		int runs = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<float, std::milli> elapsed(0.0f);
+		while (elapsed.count() < milliseconds)
+		{
+			if (jobs)
+			{
+				_cast_rays_parallel(rays);
+			}
+			else
+			{
+				_cast_rays(rays);
+			}
+			runs++;
+			elapsed = std::chrono::high_resolution_clock::now() - start;
+		}
+
+		return (float) runs * ray_count / (elapsed.count() * 1000.0f);
+	};
+
+	float single_rate = measure(false);
+	float batch_rate = measure(true);
+
+	int hit_count = 0;
+	int mismatches = 0;
+	for (int r = 0; r < ray_count; r++)
+	{
+		hit_count += single_hits[r];
+		mismatches += single_hits[r] != batch_hits[r] || (single_hits[r] && single_t[r] != batch_t[r]) ? 1 : 0;
+	}
+
+	printf("%d chunks of %dx%d samples, %d rays, %d hit\n", (int) chunks.size(), params._size, params._size,
+		ray_count, hit_count);
+	printf("%-16s %-16s %-8s %s\n", "single Mrays/s", "batched Mrays/s", "speedup", "mismatch");
+	printf("%-16.3f %-16.3f %-8.2f %d\n", single_rate, batch_rate, batch_rate / single_rate, mismatches);
+
+	for (ga_terrain_chunk* chunk : chunks)
+	{
+		delete chunk;
+	}
+
+	ga_job::shutdown();
+	return 0;
+}